@@ -0,0 +1,202 @@
+// cli/bench/succinct_bench_cli.cpp
+//
+// Microbenchmark for SuccinctBitVector select on real LOUDS artifacts.
+// Compares select with sampled hints against the hint-less block binary search
+// on the LBS and isLeaf bitvectors of the given files, and getLetter (surface
+// reconstruction) by rank/select climbing against the parent table.
+//
+// Usage:
+//   ./succinct_bench_cli --louds build/yomi_termid.louds --louds build/tango.louds
+//   ./succinct_bench_cli --louds build/tango.louds --queries 2000000 --seed 7
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common/bit_vector_utf16.hpp"
+#include "common/succinct_bit_vector_utf16.hpp"
+#include "louds/louds_utf16_reader.hpp"
+#include "louds/louds_utf16_writer.hpp"
+
+static void usage(const char *argv0)
+{
+    std::cout
+        << "Usage:\n"
+        << "  " << argv0 << " --louds <file> [--louds <file> ...] [--queries N] [--seed S]\n";
+}
+
+template <class F>
+static double time_ns_per_op(const std::vector<int> &queries, F f, uint64_t &sink)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int q : queries)
+        sink += static_cast<uint64_t>(f(q));
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return queries.empty() ? 0.0 : ns / static_cast<double>(queries.size());
+}
+
+static std::vector<int> random_queries(int lo, int hi, size_t n, std::mt19937 &rng)
+{
+    std::vector<int> out;
+    if (hi < lo)
+        return out;
+    std::uniform_int_distribution<int> dist(lo, hi);
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        out.push_back(dist(rng));
+    return out;
+}
+
+static void bench_bits(const std::string &name, const BitVector &bv, size_t nQueries, std::mt19937 &rng)
+{
+    const SuccinctBitVector plain(bv, /*withSelectHints=*/false);
+    const SuccinctBitVector hinted(bv, /*withSelectHints=*/true);
+
+    const int ones = hinted.totalOnes();
+    const int zeros = hinted.size() - ones;
+
+    std::cout << name << ": bits=" << bv.size() << " ones=" << ones << " zeros=" << zeros
+              << " index_bytes(no hints)=" << plain.indexSizeInBytes()
+              << " index_bytes(hints)=" << hinted.indexSizeInBytes() << "\n";
+
+    const auto q1 = random_queries(1, ones, nQueries, rng);
+    const auto q0 = random_queries(1, zeros, nQueries, rng);
+    const auto qpos = random_queries(0, hinted.size() - 1, nQueries, rng);
+
+    uint64_t sink = 0;
+    std::cout << std::fixed << std::setprecision(1);
+
+    const double s1p = time_ns_per_op(q1, [&](int k)
+                                      { return plain.select1(k); }, sink);
+    const double s1h = time_ns_per_op(q1, [&](int k)
+                                      { return hinted.select1(k); }, sink);
+    std::cout << "  select1       binary=" << s1p << "ns  hinted=" << s1h << "ns\n";
+
+    const double s0p = time_ns_per_op(q0, [&](int k)
+                                      { return plain.select0(k); }, sink);
+    const double s0h = time_ns_per_op(q0, [&](int k)
+                                      { return hinted.select0(k); }, sink);
+    std::cout << "  select0       binary=" << s0p << "ns  hinted=" << s0h << "ns\n";
+
+    // LOUDS firstChild pattern: select0(rank1(pos)) + 1
+    const double fcp = time_ns_per_op(qpos, [&](int pos)
+                                      { return plain.select0(plain.rank1(pos)) + 1; }, sink);
+    const double fch = time_ns_per_op(qpos, [&](int pos)
+                                      { return hinted.select0(hinted.rank1(pos)) + 1; }, sink);
+    std::cout << "  firstChild    binary=" << fcp << "ns  hinted=" << fch << "ns\n";
+
+    // cross-check: both variants must agree
+    for (size_t i = 0; i < std::min<size_t>(q1.size(), 10000); ++i)
+    {
+        if (plain.select1(q1[i]) != hinted.select1(q1[i]))
+            throw std::runtime_error("select1 mismatch at k=" + std::to_string(q1[i]));
+    }
+    for (size_t i = 0; i < std::min<size_t>(q0.size(), 10000); ++i)
+    {
+        if (plain.select0(q0[i]) != hinted.select0(q0[i]))
+            throw std::runtime_error("select0 mismatch at k=" + std::to_string(q0[i]));
+    }
+
+    std::cout << "  (checksum " << sink << ")\n";
+}
+
+// getLetter on random nodes: rank0 + select1 per character vs ParentTableUtf16.
+static void bench_get_letter(const LOUDSUtf16 &louds, size_t nQueries, std::mt19937 &rng)
+{
+    if (louds.labels.empty())
+        return; // labels8 file: no 16-bit labels to reconstruct from
+
+    // The constructor ignores file sections, so `climb` never has the table.
+    const LOUDSReaderUtf16 climb(louds.LBS, louds.isLeaf, louds.labels);
+    LOUDSReaderUtf16 table(louds.LBS, louds.isLeaf, louds.labels);
+    table.enableParentTable();
+
+    const SuccinctBitVector lbs(louds.LBS);
+    std::vector<int> nodes = random_queries(2, lbs.totalOnes(), nQueries, rng);
+    for (int &k : nodes)
+        k = lbs.select1(k);
+
+    uint64_t sink = 0;
+    std::cout << std::fixed << std::setprecision(1);
+    const double tc = time_ns_per_op(nodes, [&](int pos)
+                                     { return climb.getLetter(pos).size(); }, sink);
+    const double tt = time_ns_per_op(nodes, [&](int pos)
+                                     { return table.getLetter(pos).size(); }, sink);
+    std::cout << "getLetter       rank/select=" << tc << "ns  parents=" << tt << "ns"
+              << "  (table " << ParentTableUtf16::serialize(BitVectorView(louds.LBS)).size() << " bytes)\n";
+
+    for (size_t i = 0; i < std::min<size_t>(nodes.size(), 10000); ++i)
+    {
+        if (climb.getLetter(nodes[i]) != table.getLetter(nodes[i]))
+            throw std::runtime_error("getLetter mismatch at pos=" + std::to_string(nodes[i]));
+    }
+    std::cout << "  (checksum " << sink << ")\n";
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        std::vector<std::string> paths;
+        size_t nQueries = 1000000;
+        unsigned seed = 1;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string a = argv[i];
+            if (a == "--help" || a == "-h")
+            {
+                usage(argv[0]);
+                return 0;
+            }
+            if (a == "--louds" && i + 1 < argc)
+            {
+                paths.emplace_back(argv[++i]);
+                continue;
+            }
+            if (a == "--queries" && i + 1 < argc)
+            {
+                nQueries = static_cast<size_t>(std::stoul(argv[++i]));
+                continue;
+            }
+            if (a == "--seed" && i + 1 < argc)
+            {
+                seed = static_cast<unsigned>(std::stoul(argv[++i]));
+                continue;
+            }
+            throw std::runtime_error("Unknown/incomplete arg: " + a);
+        }
+
+        if (paths.empty())
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        std::mt19937 rng(seed);
+        for (const auto &path : paths)
+        {
+            // LOUDSUtf16 reads LBS/isLeaf/labels and ignores the termId section,
+            // so it works for both yomi_termid.louds and tango.louds.
+            const auto louds = LOUDSUtf16::loadFromFile(path);
+            std::cout << "== " << path << "\n";
+            bench_bits("LBS", louds.LBS, nQueries, rng);
+            bench_bits("isLeaf", louds.isLeaf, nQueries, rng);
+            bench_get_letter(louds, nQueries, rng);
+        }
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,461 @@
+// cli/bench/yomi_backend_bench_cli.cpp
+//
+// Compares the yomi trie backends on the lookup GraphBuilder makes at every
+// input position: the fused common-prefix search returning (length, termId).
+//   - LOUDSWithTermIdReaderUtf16 over yomi_termid.louds (with and without the root dispatch table)
+//   - DoubleArrayReaderUtf16 over yomi_termid.da (tries_token_builder --double_array)
+//   - PatriciaLOUDSReaderUtf16 over yomi_termid.plouds (tries_token_builder --patricia)
+//   - DawgReaderUtf16 over yomi_termid.dawg (tries_token_builder --dawg)
+// Prints ns per query, hits, and the bytes each backend keeps resident, and
+// checks that every backend returns the same hits. --da, --plouds and --dawg are optional.
+// --fuzzy also times LOUDSWithTermIdReaderUtf16::fuzzyCommonPrefixSearch (the
+// typo-tolerant lookup of GraphBuilder's FuzzyLattice) at edit budgets 1 and 2
+// on the first 200000 queries.
+// --aho_corasick compares, per whole line, one findAllMatches scan against a
+// common-prefix search from every position (what GraphBuilder does without it).
+//
+// Queries are every suffix of every line of --input (UTF-8 text, e.g. kana
+// sentences), like GraphBuilder::constructGraph. Without --input, random
+// hiragana strings are used.
+//
+// Usage:
+//   ./yomi_backend_bench_cli --louds build/yomi_termid.louds --da build/yomi_termid.da --input kana.txt
+//   ./yomi_backend_bench_cli --louds build/yomi_termid.louds --da build/yomi_termid.da --queries 1000000 --seed 7 --mmap
+//   ./yomi_backend_bench_cli --louds build/yomi_termid.louds --plouds build/yomi_termid.plouds --input kana.txt
+//   ./yomi_backend_bench_cli --louds build/yomi_termid.louds --dawg build/yomi_termid.dawg --input kana.txt
+//   ./yomi_backend_bench_cli --louds build/yomi_termid.louds --input kana.txt --fuzzy
+//   ./yomi_backend_bench_cli --louds build/yomi_termid.louds --input kana.txt --aho_corasick
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dawg/dawg_reader_utf16.hpp"
+#include "double_array/double_array_reader_utf16.hpp"
+#include "louds_with_term_id/louds_with_term_id_reader_utf16.hpp"
+#include "patricia/patricia_louds_reader_utf16.hpp"
+
+// -----------------------------
+// UTF-8 -> UTF-16 (strict)  (same as astar_bunsetsu_cli.cpp)
+// -----------------------------
+static bool utf8_next_codepoint(std::string_view s, size_t &i, char32_t &out_cp)
+{
+    if (i >= s.size())
+        return false;
+    const unsigned char c0 = static_cast<unsigned char>(s[i]);
+
+    if (c0 < 0x80)
+    {
+        out_cp = c0;
+        ++i;
+        return true;
+    }
+
+    if ((c0 & 0xE0) == 0xC0)
+    {
+        if (i + 1 >= s.size())
+            return false;
+        const unsigned char c1 = static_cast<unsigned char>(s[i + 1]);
+        if ((c1 & 0xC0) != 0x80)
+            return false;
+        char32_t cp = (c0 & 0x1F);
+        cp = (cp << 6) | (c1 & 0x3F);
+        if (cp < 0x80)
+            return false;
+        out_cp = cp;
+        i += 2;
+        return true;
+    }
+
+    if ((c0 & 0xF0) == 0xE0)
+    {
+        if (i + 2 >= s.size())
+            return false;
+        const unsigned char c1 = static_cast<unsigned char>(s[i + 1]);
+        const unsigned char c2 = static_cast<unsigned char>(s[i + 2]);
+        if ((c1 & 0xC0) != 0x80 || (c2 & 0xC0) != 0x80)
+            return false;
+        char32_t cp = (c0 & 0x0F);
+        cp = (cp << 6) | (c1 & 0x3F);
+        cp = (cp << 6) | (c2 & 0x3F);
+        if (cp < 0x800)
+            return false;
+        if (cp >= 0xD800 && cp <= 0xDFFF)
+            return false;
+        out_cp = cp;
+        i += 3;
+        return true;
+    }
+
+    if ((c0 & 0xF8) == 0xF0)
+    {
+        if (i + 3 >= s.size())
+            return false;
+        const unsigned char c1 = static_cast<unsigned char>(s[i + 1]);
+        const unsigned char c2 = static_cast<unsigned char>(s[i + 2]);
+        const unsigned char c3 = static_cast<unsigned char>(s[i + 3]);
+        if ((c1 & 0xC0) != 0x80 || (c2 & 0xC0) != 0x80 || (c3 & 0xC0) != 0x80)
+            return false;
+        char32_t cp = (c0 & 0x07);
+        cp = (cp << 6) | (c1 & 0x3F);
+        cp = (cp << 6) | (c2 & 0x3F);
+        cp = (cp << 6) | (c3 & 0x3F);
+        if (cp < 0x10000)
+            return false;
+        if (cp > 0x10FFFF)
+            return false;
+        out_cp = cp;
+        i += 4;
+        return true;
+    }
+
+    return false;
+}
+
+static bool utf8_to_u16(std::string_view s, std::u16string &out)
+{
+    out.clear();
+    out.reserve(s.size());
+
+    size_t i = 0;
+    while (i < s.size())
+    {
+        char32_t cp = 0;
+        if (!utf8_next_codepoint(s, i, cp))
+            return false;
+
+        if (cp <= 0xFFFF)
+        {
+            if (cp >= 0xD800 && cp <= 0xDFFF)
+                return false;
+            out.push_back(static_cast<char16_t>(cp));
+        }
+        else
+        {
+            cp -= 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + ((cp >> 10) & 0x3FF)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+        }
+    }
+    return true;
+}
+
+static void usage(const char *argv0)
+{
+    std::cout
+        << "Usage:\n"
+        << "  " << argv0 << " --louds <yomi_termid.louds> [--da <yomi_termid.da>] [--plouds <yomi_termid.plouds>]"
+        << " [--dawg <yomi_termid.dawg>]"
+        << " [--input <utf8 file>] [--queries N] [--seed S] [--mmap] [--fuzzy] [--aho_corasick]\n";
+}
+
+static std::vector<std::u16string> read_lines(const std::string &path)
+{
+    std::ifstream ifs(path);
+    if (!ifs)
+        throw std::runtime_error("failed to open file for read: " + path);
+
+    std::vector<std::u16string> out;
+    std::string line;
+    std::u16string u16;
+    while (std::getline(ifs, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || !utf8_to_u16(line, u16))
+            continue;
+        out.push_back(u16);
+    }
+    return out;
+}
+
+static std::vector<std::u16string> suffix_queries(const std::vector<std::u16string> &lines)
+{
+    std::vector<std::u16string> out;
+    for (const auto &line : lines)
+    {
+        for (size_t i = 0; i < line.size(); ++i)
+            out.emplace_back(line, i);
+    }
+    return out;
+}
+
+static std::vector<std::u16string> random_queries(size_t n, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> len(1, 12);
+    std::uniform_int_distribution<int> kana(0x3041, 0x3093);
+    std::vector<std::u16string> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        std::u16string q(static_cast<size_t>(len(rng)), u' ');
+        for (auto &ch : q)
+            ch = static_cast<char16_t>(kana(rng));
+        out.push_back(std::move(q));
+    }
+    return out;
+}
+
+template <class Reader>
+static double time_ns_per_query(const Reader &reader, const std::vector<std::u16string> &queries,
+                                uint64_t &hits, uint64_t &sink)
+{
+    std::vector<PrefixHitUtf16> out;
+    hits = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const auto &q : queries)
+    {
+        hits += reader.commonPrefixSearch(q, out);
+        for (const auto &h : out)
+            sink += static_cast<uint64_t>(h.termId);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return queries.empty() ? 0.0 : ns / static_cast<double>(queries.size());
+}
+
+static double time_fuzzy_ns_per_query(const LOUDSWithTermIdReaderUtf16 &reader, const std::vector<std::u16string> &queries,
+                                      const LOUDSWithTermIdReaderUtf16::FuzzyOptions &opt, uint64_t &hits, uint64_t &sink)
+{
+    std::vector<LOUDSWithTermIdReaderUtf16::FuzzyHit> out;
+    const size_t n = std::min<size_t>(queries.size(), 200000);
+    hits = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i)
+    {
+        hits += reader.fuzzyCommonPrefixSearch(queries[i], opt, out);
+        for (const auto &h : out)
+            sink += static_cast<uint64_t>(h.termId) + h.cost;
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return n == 0 ? 0.0 : ns / static_cast<double>(n);
+}
+
+// All dictionary matches of every line: one Aho-Corasick scan per line, or
+// (ahoCorasick == false) a common-prefix search from every position.
+static double time_lines_ns_per_line(const LOUDSWithTermIdReaderUtf16 &reader, const std::vector<std::u16string> &lines,
+                                     bool ahoCorasick, uint64_t &hits, uint64_t &sink)
+{
+    std::vector<LOUDSWithTermIdReaderUtf16::Match> matches;
+    std::vector<PrefixHitUtf16> out;
+    hits = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const auto &line : lines)
+    {
+        if (ahoCorasick)
+        {
+            hits += reader.findAllMatches(line, matches);
+            for (const auto &m : matches)
+                sink += static_cast<uint64_t>(m.termId);
+            continue;
+        }
+        for (size_t i = 0; i < line.size(); ++i)
+        {
+            hits += reader.commonPrefixSearch(std::u16string_view(line).substr(i), out);
+            for (const auto &h : out)
+                sink += static_cast<uint64_t>(h.termId);
+        }
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return lines.empty() ? 0.0 : ns / static_cast<double>(lines.size());
+}
+
+// Both backends must return the same hits.
+template <class Other>
+static void cross_check(const LOUDSWithTermIdReaderUtf16 &louds, const Other &other,
+                        const std::vector<std::u16string> &queries, const std::string &name)
+{
+    std::vector<PrefixHitUtf16> a;
+    std::vector<PrefixHitUtf16> b;
+    for (size_t i = 0; i < std::min<size_t>(queries.size(), 100000); ++i)
+    {
+        louds.commonPrefixSearch(queries[i], a);
+        other.commonPrefixSearch(queries[i], b);
+        bool same = a.size() == b.size();
+        for (size_t k = 0; same && k < a.size(); ++k)
+            same = a[k].length == b[k].length && a[k].termId == b[k].termId;
+        if (!same)
+            throw std::runtime_error(name + ": backend mismatch at query " + std::to_string(i));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        std::string louds_path;
+        std::string da_path;
+        std::string plouds_path;
+        std::string dawg_path;
+        std::string input_path;
+        size_t nQueries = 1000000;
+        unsigned seed = 1;
+        bool use_mmap = false;
+        bool fuzzy = false;
+        bool ahoCorasick = false;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string a = argv[i];
+            if (a == "--help" || a == "-h")
+            {
+                usage(argv[0]);
+                return 0;
+            }
+            if (a == "--louds" && i + 1 < argc)
+            {
+                louds_path = argv[++i];
+                continue;
+            }
+            if (a == "--da" && i + 1 < argc)
+            {
+                da_path = argv[++i];
+                continue;
+            }
+            if (a == "--plouds" && i + 1 < argc)
+            {
+                plouds_path = argv[++i];
+                continue;
+            }
+            if (a == "--dawg" && i + 1 < argc)
+            {
+                dawg_path = argv[++i];
+                continue;
+            }
+            if (a == "--input" && i + 1 < argc)
+            {
+                input_path = argv[++i];
+                continue;
+            }
+            if (a == "--queries" && i + 1 < argc)
+            {
+                nQueries = static_cast<size_t>(std::stoul(argv[++i]));
+                continue;
+            }
+            if (a == "--seed" && i + 1 < argc)
+            {
+                seed = static_cast<unsigned>(std::stoul(argv[++i]));
+                continue;
+            }
+            if (a == "--mmap")
+            {
+                use_mmap = true;
+                continue;
+            }
+            if (a == "--fuzzy")
+            {
+                fuzzy = true;
+                continue;
+            }
+            if (a == "--aho_corasick")
+            {
+                ahoCorasick = true;
+                continue;
+            }
+            throw std::runtime_error("Unknown/incomplete arg: " + a);
+        }
+
+        if (louds_path.empty())
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        std::mt19937 rng(seed);
+        // Without --input, each random string is also a "line" for --aho_corasick.
+        const auto lines = input_path.empty() ? random_queries(nQueries, rng) : read_lines(input_path);
+        const auto queries = input_path.empty() ? lines : suffix_queries(lines);
+
+        auto louds = use_mmap ? LOUDSWithTermIdReaderUtf16::mapFromFile(louds_path)
+                              : LOUDSWithTermIdReaderUtf16::loadFromFile(louds_path);
+
+        uint64_t sink = 0;
+        uint64_t hits = 0;
+        std::cout << "queries=" << queries.size() << "\n"
+                  << std::fixed << std::setprecision(1);
+
+        // LOUDS keeps the file resident (the rank/select index is persisted in it).
+        const double tl = time_ns_per_query(louds, queries, hits, sink);
+        std::cout << "louds              " << tl << " ns/query  hits=" << hits
+                  << "  bytes=" << std::filesystem::file_size(louds_path) << "\n";
+
+        louds.enableRootDispatch();
+        const double tr = time_ns_per_query(louds, queries, hits, sink);
+        std::cout << "louds+rootDispatch " << tr << " ns/query  hits=" << hits << "  (+table)\n";
+
+        if (!da_path.empty())
+        {
+            const auto da = use_mmap ? DoubleArrayReaderUtf16::mapFromFile(da_path)
+                                     : DoubleArrayReaderUtf16::loadFromFile(da_path);
+            cross_check(louds, da, queries, "double-array");
+            const double td = time_ns_per_query(da, queries, hits, sink);
+            std::cout << "double-array       " << td << " ns/query  hits=" << hits
+                      << "  bytes=" << da.memoryBytes() << " (keys=" << da.keyCount() << ")\n";
+        }
+
+        if (!plouds_path.empty())
+        {
+            const auto pl = use_mmap ? PatriciaLOUDSReaderUtf16::mapFromFile(plouds_path)
+                                     : PatriciaLOUDSReaderUtf16::loadFromFile(plouds_path);
+            cross_check(louds, pl, queries, "patricia");
+            const double tp = time_ns_per_query(pl, queries, hits, sink);
+            std::cout << "patricia           " << tp << " ns/query  hits=" << hits
+                      << "  bytes=" << std::filesystem::file_size(plouds_path) << " (nodes=" << pl.nodeCount() << ")\n";
+        }
+
+        if (!dawg_path.empty())
+        {
+            const auto dw = use_mmap ? DawgReaderUtf16::mapFromFile(dawg_path)
+                                     : DawgReaderUtf16::loadFromFile(dawg_path);
+            cross_check(louds, dw, queries, "dawg");
+            const double tw = time_ns_per_query(dw, queries, hits, sink);
+            std::cout << "dawg               " << tw << " ns/query  hits=" << hits
+                      << "  bytes=" << std::filesystem::file_size(dawg_path) << " (states=" << dw.stateCount()
+                      << " edges=" << dw.edgeCount() << ")\n";
+        }
+
+        if (fuzzy)
+        {
+            for (uint16_t budget : {uint16_t{1}, uint16_t{2}})
+            {
+                LOUDSWithTermIdReaderUtf16::FuzzyOptions opt;
+                opt.maxCost = budget;
+                const double tf = time_fuzzy_ns_per_query(louds, queries, opt, hits, sink);
+                std::cout << "louds fuzzy max=" << budget << "   " << tf << " ns/query  hits=" << hits << "\n";
+            }
+        }
+
+        if (ahoCorasick)
+        {
+            louds.enableAhoCorasick();
+            const double tc = time_lines_ns_per_line(louds, lines, false, hits, sink);
+            std::cout << "lines=" << lines.size() << "\n"
+                      << "louds cps/position " << tc << " ns/line  matches=" << hits << "\n";
+            const uint64_t cpsHits = hits;
+            const double ta = time_lines_ns_per_line(louds, lines, true, hits, sink);
+            std::cout << "louds aho-corasick " << ta << " ns/line  matches=" << hits << "\n";
+            if (hits != cpsHits)
+                throw std::runtime_error("aho-corasick: match count differs from the per-position search");
+        }
+
+        std::cout << "(checksum " << sink << ")\n";
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -1,16 +1,19 @@
 // cli/kana_kanji/astar_bunsetsu_cli.cpp
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
 
-#include "connection_id/connection_id_builder.hpp"
+#include "dawg/dawg_reader_utf16.hpp"
+#include "double_array/double_array_reader_utf16.hpp"
 #include "graph_builder/graph.hpp"
 #include "louds/louds_utf16_reader.hpp"
 #include "louds_with_term_id/louds_with_term_id_reader_utf16.hpp"
-#include "louds_with_term_id/louds_with_term_id_utf16.hpp"
+#include "patricia/patricia_louds_reader_utf16.hpp"
 #include "path_algorithm/find_path.hpp"
+#include "token_array/surface_pool.hpp"
 #include "token_array/token_array.hpp"
 
 // -----------------------------
@@ -186,16 +189,45 @@ static void usage(const char *argv0)
         << "Usage:\n"
         << "  " << argv0
         << " --yomi_termid <yomi_termid.louds> --tango <tango.louds> --tokens <token_array.bin>\n"
-        << "      --pos_table <pos_table.bin> --conn <connection_single_column.bin>\n"
-        << "      --q <utf8> [--n N] [--beam W] [--show_bunsetsu]\n"
+        << "      --pos_table <pos_table.bin> --conn <connection_matrix.bin|connection_single_column.bin>\n"
+        << "      --q <utf8> [--n N] [--beam W] [--show_bunsetsu] [--mmap]\n"
         << "  " << argv0
         << " --yomi_termid <yomi_termid.louds> --tango <tango.louds> --tokens <token_array.bin>\n"
-        << "      --pos_table <pos_table.bin> --conn <connection_single_column.bin>\n"
-        << "      --stdin [--n N] [--beam W] [--show_bunsetsu]\n";
+        << "      --pos_table <pos_table.bin> --conn <connection_matrix.bin|connection_single_column.bin>\n"
+        << "      --stdin [--n N] [--beam W] [--show_bunsetsu] [--mmap]\n"
+        << "  (--yomi_da <yomi_termid.da> instead of --yomi_termid uses the double-array yomi backend,\n"
+        << "   --yomi_patricia <yomi_termid.plouds> the path-compressed LOUDS one,\n"
+        << "   --yomi_dawg <yomi_termid.dawg> the minimized automaton)\n"
+        << "  (--fuzzy [--fuzzy_max C] [--fuzzy_penalty P]: also add typo hits at P per edit cost, up to C\n"
+        << "   (1: dakuten/small kana only, the default; 2: also one insertion, deletion or substitution; --yomi_termid only)\n"
+        << "  (--aho_corasick: find the yomi hits of the whole query in one Aho-Corasick scan; --yomi_termid only)\n"
+        << "  (--surfaces <tango_surfaces.bin>: decode surfaces from the front-coded pool instead of tango.louds;\n"
+        << "   token_array.bin must come from the same tries_token_builder --surface_pool run)\n"
+        << "  (--max_tokens_per_term K: put only the K cheapest tokens of each yomi hit into the lattice;\n"
+        << "   needs a token_array.bin with cost-sorted posting lists, the tries_token_builder default)\n";
 }
 
-static void run_one(const LOUDSReaderUtf16 &yomiCps,
-                    const LOUDSWithTermIdReaderUtf16 &yomiTerm,
+// Lattice for one query; fuzzy is only honoured by the LOUDS backend below.
+template <class YomiTerm>
+static kk::Graph build_graph(const std::u16string &q16, const YomiTerm &yomiTerm, const TokenArray &tokens,
+                             const kk::PosTable &pos, const LOUDSReaderUtf16 &tango, const kk::FuzzyLattice *,
+                             size_t maxTokensPerTerm)
+{
+    return kk::GraphBuilder::constructGraph(q16, yomiTerm, tokens, pos, tango, maxTokensPerTerm);
+}
+
+static kk::Graph build_graph(const std::u16string &q16, const LOUDSWithTermIdReaderUtf16 &yomiTerm, const TokenArray &tokens,
+                             const kk::PosTable &pos, const LOUDSReaderUtf16 &tango, const kk::FuzzyLattice *fuzzy,
+                             size_t maxTokensPerTerm)
+{
+    if (fuzzy)
+        return kk::GraphBuilder::constructGraph(q16, yomiTerm, tokens, pos, tango, *fuzzy, maxTokensPerTerm);
+    return kk::GraphBuilder::constructGraph(q16, yomiTerm, tokens, pos, tango, maxTokensPerTerm);
+}
+
+// YomiTerm: LOUDSWithTermIdReaderUtf16, DoubleArrayReaderUtf16 or PatriciaLOUDSReaderUtf16
+template <class YomiTerm>
+static void run_one(const YomiTerm &yomiTerm,
                     const TokenArray &tokens,
                     const kk::PosTable &pos,
                     const LOUDSReaderUtf16 &tango,
@@ -203,7 +235,9 @@ static void run_one(const LOUDSReaderUtf16 &yomiCps,
                     const std::string &q_utf8,
                     int nBest,
                     int beamWidth,
-                    bool showBunsetsu)
+                    bool showBunsetsu,
+                    const kk::FuzzyLattice *fuzzy,
+                    size_t maxTokensPerTerm)
 {
     std::u16string q16;
     if (!utf8_to_u16(q_utf8, q16))
@@ -213,7 +247,7 @@ static void run_one(const LOUDSReaderUtf16 &yomiCps,
     }
 
     // 1) build graph
-    kk::Graph graph = kk::GraphBuilder::constructGraph(q16, yomiCps, yomiTerm, tokens, pos, tango);
+    kk::Graph graph = build_graph(q16, yomiTerm, tokens, pos, tango, fuzzy, maxTokensPerTerm);
 
     // 2) search
     auto [cands, bunsetsu] = kk::FindPath::backwardAStarWithBunsetsu(
@@ -257,8 +291,12 @@ int main(int argc, char **argv)
     try
     {
         std::string yomi_termid_path;
+        std::string yomi_da_path;
+        std::string yomi_patricia_path;
+        std::string yomi_dawg_path;
         std::string tango_path;
         std::string tokens_path;
+        std::string surfaces_path;
         std::string pos_path;
         std::string conn_path;
 
@@ -268,6 +306,11 @@ int main(int argc, char **argv)
         int nBest = 10;
         int beamWidth = 20;
         bool showBunsetsu = false;
+        bool use_mmap = false;
+        bool fuzzy = false;
+        bool ahoCorasick = false;
+        size_t maxTokensPerTerm = SIZE_MAX;
+        kk::FuzzyLattice fuzzyLattice;
 
         for (int i = 1; i < argc; ++i)
         {
@@ -282,6 +325,21 @@ int main(int argc, char **argv)
                 yomi_termid_path = argv[++i];
                 continue;
             }
+            if (a == "--yomi_da" && i + 1 < argc)
+            {
+                yomi_da_path = argv[++i];
+                continue;
+            }
+            if (a == "--yomi_patricia" && i + 1 < argc)
+            {
+                yomi_patricia_path = argv[++i];
+                continue;
+            }
+            if (a == "--yomi_dawg" && i + 1 < argc)
+            {
+                yomi_dawg_path = argv[++i];
+                continue;
+            }
             if (a == "--tango" && i + 1 < argc)
             {
                 tango_path = argv[++i];
@@ -292,6 +350,11 @@ int main(int argc, char **argv)
                 tokens_path = argv[++i];
                 continue;
             }
+            if (a == "--surfaces" && i + 1 < argc)
+            {
+                surfaces_path = argv[++i];
+                continue;
+            }
             if (a == "--pos_table" && i + 1 < argc)
             {
                 pos_path = argv[++i];
@@ -327,48 +390,128 @@ int main(int argc, char **argv)
                 showBunsetsu = true;
                 continue;
             }
+            if (a == "--mmap")
+            {
+                use_mmap = true;
+                continue;
+            }
+            if (a == "--fuzzy")
+            {
+                fuzzy = true;
+                continue;
+            }
+            if (a == "--aho_corasick")
+            {
+                ahoCorasick = true;
+                continue;
+            }
+            if (a == "--max_tokens_per_term" && i + 1 < argc)
+            {
+                maxTokensPerTerm = static_cast<size_t>(std::stoul(argv[++i]));
+                if (maxTokensPerTerm == 0)
+                    throw std::runtime_error("--max_tokens_per_term must be at least 1");
+                continue;
+            }
+            if (a == "--fuzzy_max" && i + 1 < argc)
+            {
+                fuzzyLattice.options.maxCost = static_cast<uint16_t>(std::stoi(argv[++i]));
+                continue;
+            }
+            if (a == "--fuzzy_penalty" && i + 1 < argc)
+            {
+                fuzzyLattice.penaltyPerEdit = std::stoi(argv[++i]);
+                continue;
+            }
 
             throw std::runtime_error("Unknown/incomplete arg: " + a);
         }
 
-        if (yomi_termid_path.empty() || tango_path.empty() || tokens_path.empty() ||
+        const bool otherBackend = !yomi_da_path.empty() || !yomi_patricia_path.empty() || !yomi_dawg_path.empty();
+        if ((yomi_termid_path.empty() && !otherBackend) || tango_path.empty() || tokens_path.empty() ||
             pos_path.empty() || conn_path.empty() ||
             (!stdin_mode && q.empty()))
         {
             usage(argv[0]);
             return 2;
         }
+        if (fuzzy && (yomi_termid_path.empty() || otherBackend))
+            throw std::runtime_error("--fuzzy needs --yomi_termid");
+        if (ahoCorasick && (yomi_termid_path.empty() || otherBackend))
+            throw std::runtime_error("--aho_corasick needs --yomi_termid");
+        const kk::FuzzyLattice *fuzzyOpt = fuzzy ? &fuzzyLattice : nullptr;
+
+        // --mmap: map every artifact and read it in place instead of copying it.
+        const auto tango = use_mmap ? LOUDSReaderUtf16::mapFromFile(tango_path)
+                                    : LOUDSReaderUtf16::loadFromFile(tango_path);
+        auto tokens = use_mmap ? TokenArray::mapFromFile(tokens_path)
+                               : TokenArray::loadFromFile(tokens_path);
+        if (!surfaces_path.empty())
+        {
+            tokens.attachSurfacePool(std::make_shared<const SurfacePool>(
+                use_mmap ? SurfacePool::mapFromFile(surfaces_path) : SurfacePool::loadFromFile(surfaces_path)));
+        }
+        if (maxTokensPerTerm != SIZE_MAX && !tokens.postingsCostSorted())
+            throw std::runtime_error("--max_tokens_per_term needs a token_array.bin with cost-sorted posting lists");
+        const auto pos = use_mmap ? kk::PosTable::mapFromFile(pos_path)
+                                  : kk::PosTable::loadFromFile(pos_path);
 
-        // yomi_termid.louds: load twice (plain LOUDS for CPS, and WithTermId for getTermId)
-        const auto yomiCps = LOUDSReaderUtf16::loadFromFile(yomi_termid_path);
-        const auto yomiTrie = LOUDSWithTermIdUtf16::loadFromFile(yomi_termid_path);
-        const LOUDSWithTermIdReaderUtf16 yomiTerm(yomiTrie);
+        // connection matrix: connection_matrix.bin (v2) or connection_single_column.bin (Big Endian)
+        const auto conn = use_mmap ? kk::ConnectionMatrix::mapFromFile(conn_path)
+                                   : kk::ConnectionMatrix::loadFromFile(conn_path);
 
-        const auto tango = LOUDSReaderUtf16::loadFromFile(tango_path);
-        const auto tokens = TokenArray::loadFromFile(tokens_path);
-        const auto pos = kk::PosTable::loadFromFile(pos_path);
+        const auto serve = [&](const auto &yomiTerm)
+        {
+            if (!stdin_mode)
+            {
+                run_one(yomiTerm, tokens, pos, tango, conn, q, nBest, beamWidth, showBunsetsu, fuzzyOpt, maxTokensPerTerm);
+                return;
+            }
 
-        // connection matrix (Big Endian short array)
-        const auto connVec = ConnectionIdBuilder::readShortArrayFromBytesBE(conn_path);
-        const kk::ConnectionMatrix conn(std::vector<int16_t>(connVec.begin(), connVec.end()));
+            std::string line;
+            while (std::getline(std::cin, line))
+            {
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if (line.empty())
+                    continue;
+
+                run_one(yomiTerm, tokens, pos, tango, conn, line, nBest, beamWidth, showBunsetsu, fuzzyOpt, maxTokensPerTerm);
+            }
+        };
 
-        if (!stdin_mode)
+        if (!yomi_da_path.empty())
         {
-            run_one(yomiCps, yomiTerm, tokens, pos, tango, conn, q, nBest, beamWidth, showBunsetsu);
+            // double-array yomi backend (tries_token_builder --double_array)
+            serve(use_mmap ? DoubleArrayReaderUtf16::mapFromFile(yomi_da_path)
+                           : DoubleArrayReaderUtf16::loadFromFile(yomi_da_path));
             return 0;
         }
 
-        std::string line;
-        while (std::getline(std::cin, line))
+        if (!yomi_patricia_path.empty())
         {
-            if (!line.empty() && line.back() == '\r')
-                line.pop_back();
-            if (line.empty())
-                continue;
+            // path-compressed yomi backend (tries_token_builder --patricia)
+            serve(use_mmap ? PatriciaLOUDSReaderUtf16::mapFromFile(yomi_patricia_path)
+                           : PatriciaLOUDSReaderUtf16::loadFromFile(yomi_patricia_path));
+            return 0;
+        }
 
-            run_one(yomiCps, yomiTerm, tokens, pos, tango, conn, line, nBest, beamWidth, showBunsetsu);
+        if (!yomi_dawg_path.empty())
+        {
+            // minimized yomi automaton (tries_token_builder --dawg)
+            serve(use_mmap ? DawgReaderUtf16::mapFromFile(yomi_dawg_path)
+                           : DawgReaderUtf16::loadFromFile(yomi_dawg_path));
+            return 0;
         }
 
+        // yomi_termid.louds: one reader serves both the prefix walk and the termId lookup
+        auto yomiTerm = use_mmap ? LOUDSWithTermIdReaderUtf16::mapFromFile(yomi_termid_path)
+                                 : LOUDSWithTermIdReaderUtf16::loadFromFile(yomi_termid_path);
+        // every prefix walk starts at the root: take the first two steps from a table
+        yomiTerm.enableRootDispatch();
+        if (ahoCorasick)
+            yomiTerm.enableAhoCorasick();
+        serve(yomiTerm);
+
         return 0;
     }
     catch (const std::exception &e)
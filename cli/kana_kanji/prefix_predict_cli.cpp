@@ -9,7 +9,6 @@
 
 #include "louds/louds_utf16_reader.hpp"
 #include "louds_with_term_id/louds_with_term_id_reader_utf16.hpp"
-#include "louds_with_term_id/louds_with_term_id_utf16.hpp"
 #include "token_array/token_array.hpp"
 
 // -----------------------------
@@ -202,17 +201,19 @@ static void usage(const char *argv0)
 {
     std::cout
         << "Usage:\n"
-        << "  " << argv0 << " --yomi_termid <yomi_termid.louds> --tango <tango.louds> --tokens <token_array.bin> --q <utf8> [--limit N] [--no_dedup]\n"
-        << "  " << argv0 << " --yomi_termid <yomi_termid.louds> --tango <tango.louds> --tokens <token_array.bin> --stdin [--limit N] [--no_dedup]\n";
+        << "  " << argv0 << " --yomi_termid <yomi_termid.louds> --tango <tango.louds> --tokens <token_array.bin> --q <utf8> [--limit N] [--no_dedup] [--mmap]\n"
+        << "  " << argv0 << " --yomi_termid <yomi_termid.louds> --tango <tango.louds> --tokens <token_array.bin> --stdin [--limit N] [--no_dedup] [--mmap]\n"
+        << "  --predict K: list the K cheapest readings that start with the query (predictive search) instead\n";
 }
 
-static void run_one(const LOUDSReaderUtf16 &yomiCps,
-                    const LOUDSWithTermIdReaderUtf16 &yomiTerm,
+// yomi_hits is reused across queries, so the prefix walk does not allocate.
+static void run_one(const LOUDSWithTermIdReaderUtf16 &yomiTerm,
                     const TokenArray &tokens,
                     const LOUDSReaderUtf16 &tango,
                     const std::string &q_utf8,
                     int limit,
-                    bool dedup)
+                    bool dedup,
+                    std::vector<LOUDSWithTermIdReaderUtf16::PrefixHit> &yomi_hits)
 {
     std::u16string q16;
     if (!utf8_to_u16(q_utf8, q16))
@@ -221,12 +222,13 @@ static void run_one(const LOUDSReaderUtf16 &yomiCps,
         return;
     }
 
-    const auto yomi_hits = yomiCps.commonPrefixSearch(q16);
+    yomiTerm.commonPrefixSearch(q16, yomi_hits);
     std::cout << "query=" << q_utf8 << " yomi_hits=" << yomi_hits.size() << "\n";
 
-    for (const auto &yomi : yomi_hits)
+    for (const auto &hit : yomi_hits)
     {
-        const int32_t termId = yomiTerm.getTermId(yomi);
+        const std::u16string yomi = q16.substr(0, hit.length);
+        const int32_t termId = hit.termId;
 
         std::string yomi8;
         if (!u16_to_utf8(yomi, yomi8))
@@ -239,8 +241,11 @@ static void run_one(const LOUDSReaderUtf16 &yomiCps,
         }
 
         auto list = tokens.getTokensForTermId(termId);
-        std::sort(list.begin(), list.end(), [](const TokenEntry &a, const TokenEntry &b)
-                  { return a.wordCost < b.wordCost; });
+        if (!tokens.postingsCostSorted())
+        {
+            std::stable_sort(list.begin(), list.end(), [](const TokenEntry &a, const TokenEntry &b)
+                             { return a.wordCost < b.wordCost; });
+        }
 
         std::unordered_set<std::string> seen;
         if (dedup)
@@ -282,6 +287,57 @@ static void run_one(const LOUDSReaderUtf16 &yomiCps,
     }
 }
 
+// Predictive search: the k cheapest readings extending the query, each with its cheapest surface.
+static void run_predict(const LOUDSWithTermIdReaderUtf16 &yomiTerm,
+                        const TokenArray &tokens,
+                        const LOUDSReaderUtf16 &tango,
+                        const std::string &q_utf8,
+                        size_t k,
+                        std::vector<LOUDSWithTermIdReaderUtf16::PredictiveHit> &hits)
+{
+    std::u16string q16;
+    if (!utf8_to_u16(q_utf8, q16))
+    {
+        std::cout << "[BAD_UTF8] " << q_utf8 << "\n";
+        return;
+    }
+
+    // Without costs in the file, fall back to BFS order (shorter readings first).
+    if (yomiTerm.hasPredictCosts())
+        yomiTerm.predictTopK(q16, k, hits);
+    else
+        yomiTerm.predictiveSearch(q16, k, hits);
+    std::cout << "query=" << q_utf8 << " predictions=" << hits.size() << "\n";
+
+    for (const auto &hit : hits)
+    {
+        std::string yomi8;
+        if (!u16_to_utf8(hit.key, yomi8))
+            yomi8 = "<BAD_U16>";
+
+        // Cost-sorted lists: the cheapest token is the first one
+        const auto list = tokens.getTokensForTermId(hit.termId, 1);
+        const auto best = std::min_element(list.begin(), list.end(), [](const TokenEntry &a, const TokenEntry &b)
+                                           { return a.wordCost < b.wordCost; });
+
+        std::string s8 = "-";
+        if (best != list.end())
+        {
+            std::u16string surface;
+            if (best->nodeIndex == TokenArray::KATAKANA_SENTINEL)
+                surface = hira_to_kata(hit.key);
+            else if (best->nodeIndex == TokenArray::HIRAGANA_SENTINEL)
+                surface = hit.key;
+            else
+                surface = tango.getLetter(best->nodeIndex);
+            if (!u16_to_utf8(surface, s8))
+                s8 = "<BAD_U16>";
+        }
+
+        std::cout << "  - " << yomi8 << "\t" << s8 << "\tcost=" << hit.cost << "\ttermId=" << hit.termId << "\n";
+    }
+}
+
 int main(int argc, char **argv)
 {
     try
@@ -293,6 +349,8 @@ int main(int argc, char **argv)
         bool stdin_mode = false;
         int limit = 20;
         bool dedup = true;
+        bool use_mmap = false;
+        size_t predict = 0;
 
         for (int i = 1; i < argc; ++i)
         {
@@ -337,6 +395,16 @@ int main(int argc, char **argv)
                 dedup = false;
                 continue;
             }
+            if (a == "--mmap")
+            {
+                use_mmap = true;
+                continue;
+            }
+            if (a == "--predict" && i + 1 < argc)
+            {
+                predict = static_cast<size_t>(std::stoul(argv[++i]));
+                continue;
+            }
             throw std::runtime_error("Unknown/incomplete arg: " + a);
         }
 
@@ -346,17 +414,31 @@ int main(int argc, char **argv)
             return 2;
         }
 
-        // yomi_termid.louds: load twice (plain LOUDS for CPS, and WithTermId for getTermId)
-        const auto yomiCps = LOUDSReaderUtf16::loadFromFile(yomi_termid_path);
-        const auto yomiTrie = LOUDSWithTermIdUtf16::loadFromFile(yomi_termid_path);
-        const LOUDSWithTermIdReaderUtf16 yomiTerm(yomiTrie);
-
-        const auto tango = LOUDSReaderUtf16::loadFromFile(tango_path);
-        const auto tokens = TokenArray::loadFromFile(tokens_path);
+        // yomi_termid.louds: one reader serves both the prefix walk and the termId lookup
+        // --mmap: map every artifact and read it in place instead of copying it.
+        auto yomiTerm = use_mmap ? LOUDSWithTermIdReaderUtf16::mapFromFile(yomi_termid_path)
+                                 : LOUDSWithTermIdReaderUtf16::loadFromFile(yomi_termid_path);
+        // every prefix walk starts at the root: take the first two steps from a table
+        yomiTerm.enableRootDispatch();
+
+        const auto tango = use_mmap ? LOUDSReaderUtf16::mapFromFile(tango_path)
+                                    : LOUDSReaderUtf16::loadFromFile(tango_path);
+        const auto tokens = use_mmap ? TokenArray::mapFromFile(tokens_path)
+                                     : TokenArray::loadFromFile(tokens_path);
+
+        std::vector<LOUDSWithTermIdReaderUtf16::PrefixHit> yomi_hits;
+        std::vector<LOUDSWithTermIdReaderUtf16::PredictiveHit> predictions;
+        const auto run = [&](const std::string &query)
+        {
+            if (predict > 0)
+                run_predict(yomiTerm, tokens, tango, query, predict, predictions);
+            else
+                run_one(yomiTerm, tokens, tango, query, limit, dedup, yomi_hits);
+        };
 
         if (!stdin_mode)
         {
-            run_one(yomiCps, yomiTerm, tokens, tango, q, limit, dedup);
+            run(q);
             return 0;
         }
 
@@ -367,7 +449,7 @@ int main(int argc, char **argv)
                 line.pop_back();
             if (line.empty())
                 continue;
-            run_one(yomiCps, yomiTerm, tokens, tango, line, limit, dedup);
+            run(line);
         }
 
         return 0;
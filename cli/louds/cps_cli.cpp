@@ -6,8 +6,10 @@
 //   ./cps_cli --louds build/mozc_reading.louds --q あいかわらず
 //   ./cps_cli --louds build/mozc_reading.louds --stdin
 //   echo "あい\nあいかわらず\nzzz" | ./cps_cli --louds build/mozc_reading.louds --stdin
+//   ./cps_cli --louds build/mozc_reading.louds --stdin --mmap   (read the file in place via mmap)
 //
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <string_view>
@@ -147,7 +149,7 @@ static void append_utf8(std::string &out, char32_t cp)
     }
 }
 
-static bool u16_to_utf8(const std::u16string &s, std::string &out)
+static bool u16_to_utf8(std::u16string_view s, std::string &out)
 {
     out.clear();
     out.reserve(s.size());
@@ -186,11 +188,12 @@ static void usage(const char *argv0)
 {
     std::cout
         << "Usage:\n"
-        << "  " << argv0 << " --louds <file> --q <utf8>\n"
-        << "  " << argv0 << " --louds <file> --stdin\n";
+        << "  " << argv0 << " --louds <file> --q <utf8> [--mmap]\n"
+        << "  " << argv0 << " --louds <file> --stdin [--mmap]\n";
 }
 
-static void run_one(const LOUDSReaderUtf16 &reader, const std::string &q_utf8)
+// lengths is reused across queries, so the search itself does not allocate.
+static void run_one(const LOUDSReaderUtf16 &reader, const std::string &q_utf8, std::vector<uint32_t> &lengths)
 {
     std::u16string q16;
     if (!utf8_to_u16(q_utf8, q16))
@@ -199,13 +202,13 @@ static void run_one(const LOUDSReaderUtf16 &reader, const std::string &q_utf8)
         return;
     }
 
-    const auto hits = reader.commonPrefixSearch(q16);
+    reader.commonPrefixSearch(q16, lengths);
 
-    std::cout << "query=" << q_utf8 << " hits=" << hits.size() << "\n";
-    for (const auto &h : hits)
+    std::cout << "query=" << q_utf8 << " hits=" << lengths.size() << "\n";
+    for (uint32_t len : lengths)
     {
         std::string h8;
-        if (!u16_to_utf8(h, h8))
+        if (!u16_to_utf8(std::u16string_view(q16).substr(0, len), h8))
             h8 = "<BAD_U16>";
         std::cout << "  - " << h8 << "\n";
     }
@@ -217,6 +220,7 @@ int main(int argc, char **argv)
     {
         std::string louds_path;
         bool stdin_mode = false;
+        bool use_mmap = false;
         std::string q;
 
         for (int i = 1; i < argc; ++i)
@@ -242,6 +246,11 @@ int main(int argc, char **argv)
                 stdin_mode = true;
                 continue;
             }
+            if (a == "--mmap")
+            {
+                use_mmap = true;
+                continue;
+            }
             throw std::runtime_error("Unknown/incomplete arg: " + a);
         }
 
@@ -251,11 +260,14 @@ int main(int argc, char **argv)
             return 2;
         }
 
-        const auto reader = LOUDSReaderUtf16::loadFromFile(louds_path);
+        auto reader = use_mmap ? LOUDSReaderUtf16::mapFromFile(louds_path)
+                               : LOUDSReaderUtf16::loadFromFile(louds_path);
+        reader.enableRootDispatch();
 
+        std::vector<uint32_t> lengths;
         if (!stdin_mode)
         {
-            run_one(reader, q);
+            run_one(reader, q, lengths);
             return 0;
         }
 
@@ -266,7 +278,7 @@ int main(int argc, char **argv)
                 line.pop_back(); // Windows対策
             if (line.empty())
                 continue;
-            run_one(reader, line);
+            run_one(reader, line, lengths);
         }
         return 0;
     }
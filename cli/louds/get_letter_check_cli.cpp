@@ -0,0 +1,111 @@
+// cli/louds/get_letter_check_cli.cpp
+//
+// Consistency check for LOUDSReaderUtf16::getLetter: the rank/select climb and
+// the parent-table path must return the same surface. Always checks a small
+// built-in trie whose surfaces contain U+0020 (leading, trailing, inner and
+// doubled; both paths drop them), then every node of each --louds file.
+// Exits 0 and prints "ok" when everything matches.
+//
+// Usage:
+//   ./get_letter_check_cli
+//   ./get_letter_check_cli --louds build/tango.louds
+//
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common/succinct_bit_vector_utf16.hpp"
+#include "louds/louds_converter_utf16.hpp"
+#include "louds/louds_utf16_reader.hpp"
+#include "louds/louds_utf16_writer.hpp"
+
+static void usage(const char *argv0)
+{
+    std::cout
+        << "Usage:\n"
+        << "  " << argv0 << " [--louds <file> ...]\n";
+}
+
+// Returns the number of nodes compared.
+static size_t check_all_nodes(const LOUDSUtf16 &louds)
+{
+    // The constructor ignores file sections, so `climb` never has the table.
+    const LOUDSReaderUtf16 climb(louds.LBS, louds.isLeaf, louds.labels);
+    LOUDSReaderUtf16 table(louds.LBS, louds.isLeaf, louds.labels);
+    table.enableParentTable();
+
+    const SuccinctBitVector lbs(louds.LBS);
+    // every 1 bit after the first (the root), as succinct_bench_cli samples them
+    size_t n = 0;
+    for (int k = 2; k <= lbs.totalOnes(); ++k, ++n)
+    {
+        const int pos = lbs.select1(k);
+        if (climb.getLetter(pos) != table.getLetter(pos))
+            throw std::runtime_error("getLetter mismatch at pos=" + std::to_string(pos));
+    }
+    return n;
+}
+
+static void check_spaces()
+{
+    const std::u16string words[] = {u"A B", u"A BC", u" lead", u"trail ", u"in  two", u"AB", u"単 語"};
+    PrefixTreeUtf16 tree;
+    for (const auto &w : words)
+        tree.insert(w);
+    const LOUDSUtf16 louds = ConverterUtf16().convert(tree.getRoot());
+
+    const LOUDSReaderUtf16 climb(louds.LBS, louds.isLeaf, louds.labels);
+    for (const auto &w : words)
+    {
+        if (climb.getNodeIndex(w) < 0)
+            throw std::runtime_error("built-in surface not found in its own trie");
+    }
+    check_all_nodes(louds);
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        std::vector<std::string> paths;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string a = argv[i];
+            if (a == "--help" || a == "-h")
+            {
+                usage(argv[0]);
+                return 0;
+            }
+            if (a == "--louds" && i + 1 < argc)
+            {
+                paths.emplace_back(argv[++i]);
+                continue;
+            }
+            throw std::runtime_error("Unknown/incomplete arg: " + a);
+        }
+
+        check_spaces();
+        std::cout << "built-in surfaces with spaces: ok\n";
+
+        for (const auto &path : paths)
+        {
+            const auto louds = LOUDSUtf16::loadFromFile(path);
+            if (louds.labels.empty())
+            {
+                std::cout << path << ": labels8 file, skipped\n";
+                continue;
+            }
+            const size_t n = check_all_nodes(louds);
+            std::cout << path << ": " << n << " nodes ok\n";
+        }
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
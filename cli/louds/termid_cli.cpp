@@ -11,7 +11,6 @@
 #include <string>
 #include <string_view>
 
-#include "louds_with_term_id/louds_with_term_id_utf16.hpp"
 #include "louds_with_term_id/louds_with_term_id_reader_utf16.hpp"
 
 // -----------------------------
@@ -180,8 +179,7 @@ int main(int argc, char **argv)
             return 2;
         }
 
-        const auto trie = LOUDSWithTermIdUtf16::loadFromFile(louds_path);
-        const LOUDSWithTermIdReaderUtf16 reader(trie);
+        const auto reader = LOUDSWithTermIdReaderUtf16::loadFromFile(louds_path);
 
         if (!stdin_mode)
         {
@@ -1,6 +1,7 @@
 #include "connection_id/connection_id_builder.hpp"
 
 #include <fstream>
+#include <iterator>
 #include <limits>
 #include <stdexcept>
 #include <string>
@@ -13,23 +14,6 @@ void ConnectionIdBuilder::write_u16_be(std::ostream &os, std::uint16_t v)
     os.put(static_cast<char>(b1));
 }
 
-bool ConnectionIdBuilder::read_u16_be(std::istream &is, std::uint16_t &v)
-{
-    const int c0 = is.get();
-    if (c0 == EOF)
-        return false; // EOF
-    const int c1 = is.get();
-    if (c1 == EOF)
-        throw std::runtime_error("Unexpected EOF: binary length is odd (not multiple of 2 bytes)");
-
-    const auto b0 = static_cast<unsigned char>(c0);
-    const auto b1 = static_cast<unsigned char>(c1);
-
-    v = static_cast<std::uint16_t>((static_cast<std::uint16_t>(b0) << 8) |
-                                   static_cast<std::uint16_t>(b1));
-    return true;
-}
-
 std::vector<std::int16_t> ConnectionIdBuilder::readSingleColumnText(
     const std::filesystem::path &path,
     bool skip_first_line)
@@ -107,17 +91,80 @@ std::vector<std::int16_t> ConnectionIdBuilder::readShortArrayFromBytesBE(
 
 std::vector<std::int16_t> ConnectionIdBuilder::readShortArrayFromBytesBE(std::istream &is)
 {
-    std::vector<std::int16_t> out;
+    // 一括で読み込んでから decode する (1 要素ごとの get() は遅い)
+    const std::vector<char> bytes{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+    if (bytes.size() % 2 != 0)
+        throw std::runtime_error("Unexpected EOF: binary length is odd (not multiple of 2 bytes)");
 
-    while (true)
+    std::vector<std::int16_t> out(bytes.size() / 2);
+    for (size_t i = 0; i < out.size(); ++i)
     {
-        std::uint16_t u = 0;
-        const bool ok = read_u16_be(is, u);
-        if (!ok)
-            break; // EOF
+        const auto b0 = static_cast<unsigned char>(bytes[2 * i]);
+        const auto b1 = static_cast<unsigned char>(bytes[2 * i + 1]);
+        out[i] = static_cast<std::int16_t>((static_cast<std::uint16_t>(b0) << 8) |
+                                           static_cast<std::uint16_t>(b1));
+    }
+
+    return out;
+}
+
+void ConnectionIdBuilder::writeMatrixV2(
+    const std::vector<std::int16_t> &v,
+    const std::filesystem::path &out_path)
+{
+    std::uint32_t dim = 0;
+    while (static_cast<std::uint64_t>(dim + 1) * (dim + 1) <= v.size())
+        ++dim;
+    if (v.empty() || static_cast<std::uint64_t>(dim) * dim != v.size())
+        throw std::runtime_error("Connection matrix is not square: " + std::to_string(v.size()));
+
+    std::filesystem::create_directories(out_path.parent_path());
+
+    std::ofstream os(out_path, std::ios::binary);
+    if (!os)
+        throw std::runtime_error("Failed to open: " + out_path.string());
+
+    const std::uint32_t header[4] = {kMatrixMagic, kMatrixVersion, kByteOrderMark, dim};
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+    os.write(reinterpret_cast<const char *>(v.data()),
+             static_cast<std::streamsize>(v.size() * sizeof(std::int16_t)));
+
+    os.flush();
+    if (!os)
+        throw std::runtime_error("Write failed: " + out_path.string());
+}
 
-        out.push_back(static_cast<std::int16_t>(u));
+std::vector<std::int16_t> ConnectionIdBuilder::readMatrixV2(
+    const std::filesystem::path &path)
+{
+    std::ifstream is(path, std::ios::binary);
+    if (!is)
+        throw std::runtime_error("Failed to open: " + path.string());
+
+    std::uint32_t header[4] = {};
+    is.read(reinterpret_cast<char *>(header), sizeof(header));
+    const bool swap = header[0] == byteSwap32(kMatrixMagic);
+    if (swap)
+    {
+        for (auto &h : header)
+            h = byteSwap32(h);
     }
+    if (!is || header[0] != kMatrixMagic || header[1] != kMatrixVersion)
+        throw std::runtime_error("Not a v2 connection matrix: " + path.string());
+    if (header[2] != kByteOrderMark)
+        throw std::runtime_error("Bad byte order mark: " + path.string());
+
+    const std::uint32_t dim = header[3];
+    std::vector<std::int16_t> out(static_cast<size_t>(dim) * dim);
+    is.read(reinterpret_cast<char *>(out.data()),
+            static_cast<std::streamsize>(out.size() * sizeof(std::int16_t)));
+    if (!is)
+        throw std::runtime_error("Truncated connection matrix: " + path.string());
 
+    if (swap)
+    {
+        for (auto &x : out)
+            x = static_cast<std::int16_t>(byteSwap16(static_cast<std::uint16_t>(x)));
+    }
     return out;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <istream>
@@ -25,7 +26,33 @@ public:
 
     static std::vector<std::int16_t> readShortArrayFromBytesBE(std::istream &is);
 
+    // v2 形式 (connection_matrix.bin): 16 byte ヘッダ + ネイティブエンディアンの int16 x dim*dim
+    //   u32 magic ("KKCM"), u32 version (2), u32 byteOrder (書き込み側で kByteOrderMark), u32 dim
+    // データは 16 byte 目から始まるので ConnectionMatrix::mapFromFile がそのまま参照できる。
+    // 別エンディアンのホストで書かれたファイルは magic が反転して見えるので、読み込み側で byte swap する。
+    static constexpr std::uint32_t kMatrixMagic = 0x4D434B4BU; // "KKCM"
+    static constexpr std::uint32_t kMatrixVersion = 2;
+    static constexpr std::uint32_t kByteOrderMark = 0x01020304U;
+    static constexpr std::size_t kMatrixHeaderSize = 16;
+
+    // v は dim*dim 個 (正方行列) であること
+    static void writeMatrixV2(
+        const std::vector<std::int16_t> &v,
+        const std::filesystem::path &out_path);
+
+    static std::vector<std::int16_t> readMatrixV2(
+        const std::filesystem::path &path);
+
+    static constexpr std::uint16_t byteSwap16(std::uint16_t v)
+    {
+        return static_cast<std::uint16_t>((v >> 8) | (v << 8));
+    }
+
+    static constexpr std::uint32_t byteSwap32(std::uint32_t v)
+    {
+        return ((v & 0xFFU) << 24) | ((v & 0xFF00U) << 8) | ((v >> 8) & 0xFF00U) | (v >> 24);
+    }
+
 private:
     static void write_u16_be(std::ostream &os, std::uint16_t v);
-    static bool read_u16_be(std::istream &is, std::uint16_t &v);
 };
@@ -10,7 +10,8 @@
 //
 // Output (binary):
 //   build/mozc_reading.louds
-//   build/connection_single_column.bin (default)
+//   build/connection_single_column.bin (default, Big Endian, Kotlin compatible)
+//   build/connection_matrix.bin        (default, v2: header + native endian, mmap-able)
 //
 // Usage:
 //   ./mozc_dic_fetch
@@ -18,7 +19,8 @@
 //
 // Notes:
 // - This builder only uses the first column (reading).
-// - Connection file is converted in Big Endian short array format for Kotlin compatibility.
+// - Connection file is converted in Big Endian short array format for Kotlin compatibility,
+//   and additionally into the v2 format that ConnectionMatrix can map in place.
 
 #include <algorithm>
 #include <cstdint>
@@ -186,9 +188,11 @@ struct Options
     fs::path in_dir = "src/dictionary_builder/mozc_fetch";
     fs::path out_file = "build/mozc_reading.louds";
     fs::path conn_out_file = "build/connection_single_column.bin";
+    fs::path conn_v2_out_file = "build/connection_matrix.bin";
     int start_index = 0;
     int end_index = 9;
     bool verbose = true;
+    bool with_index = true;
 
     bool build_connection_bin = true;
     bool conn_skip_first_line = true;
@@ -198,14 +202,15 @@ static void print_usage(const char *argv0)
 {
     std::cout
         << "Usage: " << argv0
-        << " [--in <dir>] [--out <file>] [--conn-out <file>]\n"
+        << " [--in <dir>] [--out <file>] [--conn-out <file>] [--conn-v2-out <file>]\n"
         << "             [--start <0..9>] [--end <0..9>] [--quiet]\n"
-        << "             [--no-conn] [--conn-no-skip-first]\n"
+        << "             [--no-conn] [--conn-no-skip-first] [--no-index]\n"
         << "\n"
         << "Defaults:\n"
         << "  --in       src/dictionary_builder/mozc_fetch\n"
         << "  --out      build/mozc_reading.louds\n"
         << "  --conn-out build/connection_single_column.bin\n"
+        << "  --conn-v2-out build/connection_matrix.bin\n"
         << "  --start    0\n"
         << "  --end      9\n";
 }
@@ -234,6 +239,10 @@ static Options parse_args(int argc, char **argv)
         {
             opt.conn_out_file = argv[++i];
         }
+        else if (a == "--conn-v2-out" && i + 1 < argc)
+        {
+            opt.conn_v2_out_file = argv[++i];
+        }
         else if (a == "--start" && i + 1 < argc)
         {
             opt.start_index = std::stoi(argv[++i]);
@@ -246,6 +255,10 @@ static Options parse_args(int argc, char **argv)
         {
             opt.verbose = false;
         }
+        else if (a == "--no-index")
+        {
+            opt.with_index = false;
+        }
         else if (a == "--no-conn")
         {
             opt.build_connection_bin = false;
@@ -351,7 +364,7 @@ int main(int argc, char **argv)
 
         // 5) Save LOUDS
         fs::create_directories(opt.out_file.parent_path());
-        louds.saveToFile(opt.out_file.string());
+        louds.saveToFile(opt.out_file.string(), opt.with_index);
 
         if (opt.verbose)
         {
@@ -399,8 +412,18 @@ int main(int argc, char **argv)
                     throw std::runtime_error("Connection roundtrip mismatch at i=" + std::to_string(i));
             }
 
+            // v2 (header + native endian) for ConnectionMatrix::mapFromFile
+            ConnectionIdBuilder::writeMatrixV2(values, opt.conn_v2_out_file);
+            if (ConnectionIdBuilder::readMatrixV2(opt.conn_v2_out_file) != values)
+                throw std::runtime_error("Connection v2 roundtrip mismatch");
+
             if (opt.verbose)
+            {
+                const auto bytes = fs::file_size(opt.conn_v2_out_file);
+                std::cout << "Wrote connection v2: " << opt.conn_v2_out_file.string()
+                          << " (" << bytes << " bytes)\n";
                 std::cout << "Connection roundtrip OK\n";
+            }
         }
 
         if (opt.verbose)
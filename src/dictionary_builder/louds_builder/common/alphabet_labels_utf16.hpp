@@ -0,0 +1,251 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "common/label_ops_utf16.hpp"
+
+// LOUDS のラベル列を 8 bit 符号に詰め直したもの (FileSections::kLabels8)。
+//
+// 読みの trie に現れる文字は数百種 (大半がひらがな) なので、出現頻度の高い
+// 最大 255 文字をアルファベットとして 0..254 に割り当て、残りは kEscape (255)
+// で表して別表 (ラベル位置 → 文字) に逃がす。
+// - 符号はアルファベットの文字コード順に振る (兄弟内の順序はほぼ保たれるが、
+//   エスケープが混ざるので find は二分探索せず 16 バイトずつ線形に比較する)
+// - クエリ文字は code() の表引き 1 回で符号にし、兄弟ごとには変換しない。
+//   クエリ全体を走査前に変換する形も試したが遅かった (1 歩の表引きは rank/select
+//   の待ちに隠れる一方、走査は数文字で終わるのでキー全体の変換が丸ごと増える)
+// ラベル 1 個あたり 2 バイト → 1 バイトで、兄弟走査の 1 キャッシュラインに 64 個載る。
+//
+// セクションのレイアウト (8 バイト境界を保つ):
+//   u32 alphabetN, u32 escN
+//   u64 labelN
+//   u16 alphabet[alphabetN]  (4 の倍数に詰める)
+//   u32 escIndex[escN]       (エスケープされたラベルの位置、昇順。2 の倍数に詰める)
+//   u16 escChar[escN]        (4 の倍数に詰める)
+//   u8  codes[labelN]
+//
+// parse() はバイト列をコピーせずに参照し、文字 → 符号の 64K 表だけを作る。
+// 参照先 (ファイルのマップや所有する LOUDSWithTermIdUtf16) より長生きしないこと。
+class AlphabetLabelsUtf16
+{
+public:
+    static constexpr uint8_t kEscape = 0xFF;
+    static constexpr size_t kAlphabetMax = 255;
+
+    bool empty() const { return table_.empty(); }
+    size_t size() const { return codes_.size(); }
+    size_t alphabetSize() const { return alphabet_.size(); }
+    size_t escapeCount() const { return escIndex_.size(); }
+
+    // 表を含めた読み込み時のメモリ量
+    size_t memoryBytes() const { return codes_.size() + escIndex_.size() * 6 + alphabet_.size() * 2 + table_.size(); }
+
+    // labels を符号化したセクションのバイト列
+    static std::vector<uint8_t> encode(std::span<const char16_t> labels)
+    {
+        std::vector<uint32_t> freq(0x10000, 0);
+        for (char16_t c : labels)
+            ++freq[c];
+
+        std::vector<char16_t> alphabet;
+        for (uint32_t c = 0; c < 0x10000; ++c)
+        {
+            if (freq[c] > 0)
+                alphabet.push_back(static_cast<char16_t>(c));
+        }
+        if (alphabet.size() > kAlphabetMax)
+        {
+            std::stable_sort(alphabet.begin(), alphabet.end(),
+                             [&](char16_t a, char16_t b)
+                             { return freq[a] > freq[b]; });
+            alphabet.resize(kAlphabetMax);
+            std::sort(alphabet.begin(), alphabet.end());
+        }
+
+        std::vector<uint8_t> table(0x10000, kEscape);
+        for (size_t k = 0; k < alphabet.size(); ++k)
+            table[alphabet[k]] = static_cast<uint8_t>(k);
+
+        std::vector<uint8_t> codes(labels.size());
+        std::vector<uint32_t> escIndex;
+        std::vector<char16_t> escChar;
+        for (size_t i = 0; i < labels.size(); ++i)
+        {
+            codes[i] = table[labels[i]];
+            if (codes[i] == kEscape)
+            {
+                escIndex.push_back(static_cast<uint32_t>(i));
+                escChar.push_back(labels[i]);
+            }
+        }
+
+        const uint32_t alphabetN = static_cast<uint32_t>(alphabet.size());
+        const uint32_t escN = static_cast<uint32_t>(escIndex.size());
+        const uint64_t labelN = static_cast<uint64_t>(codes.size());
+
+        // 全体の大きさを先に決めて 1 回で確保し、各欄をオフセットへ memcpy する。
+        // 0 で埋めてあるので、8 バイト境界までの詰め物は位置を進めるだけでよい
+        const auto padded = [](size_t n)
+        { return (n + 7) & ~size_t{7}; };
+        std::vector<uint8_t> out(padded(16 + alphabet.size() * sizeof(char16_t)) +
+                                 padded(escIndex.size() * sizeof(uint32_t)) +
+                                 padded(escChar.size() * sizeof(char16_t)) + codes.size());
+        size_t pos = 0;
+        const auto put = [&out, &pos](const void *p, size_t n)
+        {
+            if (n > 0)
+                std::memcpy(out.data() + pos, p, n);
+            pos += n;
+        };
+        const auto pad = [&pos, &padded]()
+        {
+            pos = padded(pos);
+        };
+
+        put(&alphabetN, sizeof(alphabetN));
+        put(&escN, sizeof(escN));
+        put(&labelN, sizeof(labelN));
+        put(alphabet.data(), alphabet.size() * sizeof(char16_t));
+        pad();
+        put(escIndex.data(), escIndex.size() * sizeof(uint32_t));
+        pad();
+        put(escChar.data(), escChar.size() * sizeof(char16_t));
+        pad();
+        put(codes.data(), codes.size());
+        return out;
+    }
+
+    // encode() の出力 (8 バイト境界に置かれていること) を参照する。壊れていれば例外。
+    void parse(std::span<const uint8_t> bytes)
+    {
+        size_t p = 0;
+        const auto take = [&](size_t n) -> const uint8_t *
+        {
+            if (n > bytes.size() - p)
+                throw std::runtime_error("AlphabetLabelsUtf16: truncated label section");
+            const uint8_t *at = bytes.data() + p;
+            p += n;
+            return at;
+        };
+        const auto align = [&]()
+        {
+            p = std::min(bytes.size(), (p + 7) & ~size_t{7});
+        };
+
+        uint32_t alphabetN = 0;
+        uint32_t escN = 0;
+        uint64_t labelN = 0;
+        std::memcpy(&alphabetN, take(sizeof(alphabetN)), sizeof(alphabetN));
+        std::memcpy(&escN, take(sizeof(escN)), sizeof(escN));
+        std::memcpy(&labelN, take(sizeof(labelN)), sizeof(labelN));
+        if (alphabetN > kAlphabetMax || escN > labelN || labelN > bytes.size())
+            throw std::runtime_error("AlphabetLabelsUtf16: malformed label section");
+
+        alphabet_ = {reinterpret_cast<const char16_t *>(take(alphabetN * sizeof(char16_t))), alphabetN};
+        align();
+        escIndex_ = {reinterpret_cast<const uint32_t *>(take(escN * sizeof(uint32_t))), escN};
+        align();
+        escChar_ = {reinterpret_cast<const char16_t *>(take(escN * sizeof(char16_t))), escN};
+        align();
+        codes_ = {take(static_cast<size_t>(labelN)), static_cast<size_t>(labelN)};
+
+        table_.assign(0x10000, kEscape);
+        for (size_t k = 0; k < alphabet_.size(); ++k)
+            table_[alphabet_[k]] = static_cast<uint8_t>(k);
+    }
+
+    uint8_t code(char16_t c) const { return table_[c]; }
+
+    // ラベル i の文字
+    char16_t at(size_t i) const
+    {
+        const uint8_t k = codes_[i];
+        return k != kEscape ? alphabet_[k] : escaped(i);
+    }
+
+    // 16 bit のラベル列に戻す (符号を読まない LOUDSReaderUtf16 用)
+    std::vector<char16_t> decode() const
+    {
+        std::vector<char16_t> labels(codes_.size());
+        size_t e = 0;
+        for (size_t i = 0; i < codes_.size(); ++i)
+        {
+            const uint8_t k = codes_[i];
+            if (k != kEscape)
+                labels[i] = alphabet_[k];
+            else if (e < escIndex_.size() && escIndex_[e] == i)
+                labels[i] = escChar_[e++];
+        }
+        return labels;
+    }
+
+    // codes[first, first + n) の中の c の位置 (区間内 0-indexed)。無ければ -1。
+    // 区間が codes をはみ出す分は切り詰める。
+    int find(size_t first, size_t n, char16_t c) const
+    {
+        if (first >= codes_.size())
+            return -1;
+        if (n > codes_.size() - first)
+            n = codes_.size() - first;
+
+        const uint8_t *base = codes_.data() + first;
+        const uint8_t k = code(c);
+        if (k != kEscape)
+            return scan(base, n, k); // 兄弟の文字は互いに異なるので符号も一意
+
+        // アルファベット外: エスケープのラベルだけを実際の文字と比べる
+        for (size_t off = 0; off < n;)
+        {
+            const int j = scan(base + off, n - off, kEscape);
+            if (j < 0)
+                return -1;
+            off += static_cast<size_t>(j);
+            if (escaped(first + off) == c)
+                return static_cast<int>(off);
+            ++off;
+        }
+        return -1;
+    }
+
+private:
+    std::span<const char16_t> alphabet_;
+    std::span<const uint32_t> escIndex_;
+    std::span<const char16_t> escChar_;
+    std::span<const uint8_t> codes_;
+    std::vector<uint8_t> table_; // 文字 → 符号 (64K、読み込み時に作る)
+
+    char16_t escaped(size_t i) const
+    {
+        const auto it = std::lower_bound(escIndex_.begin(), escIndex_.end(), static_cast<uint32_t>(i));
+        if (it == escIndex_.end() || *it != i)
+            return u'\0';
+        return escChar_[static_cast<size_t>(it - escIndex_.begin())];
+    }
+
+    static int scan(const uint8_t *p, size_t n, uint8_t k)
+    {
+        size_t i = 0;
+#ifdef KK_LABELOPS_SSE2
+        const __m128i key = _mm_set1_epi8(static_cast<char>(k));
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, key)));
+            if (mask != 0)
+                return static_cast<int>(i) + __builtin_ctz(mask);
+        }
+#endif
+        for (; i < n; ++i)
+        {
+            if (p[i] == k)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+};
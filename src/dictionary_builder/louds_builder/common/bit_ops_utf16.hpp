@@ -0,0 +1,116 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// 64bit word 単位のビット演算カーネル。
+//
+// - selectInWord: w の r 番目(0-indexed)の 1 の位置
+// - popcount64:   1 word の popcount（-mpopcnt 無しでも libgcc 呼び出しにならない）
+// - popcountWords: words[0..n) の 1 の総数
+//
+// x86-64 (GCC/Clang) では実行時に CPUID を見て BMI2 (pdep/tzcnt) と POPCNT 版を
+// 選ぶ。それ以外の環境、または KK_DISABLE_CPU_DISPATCH 定義時は可搬版のみ。
+// どちらも同じ結果を返すので、呼び出し側は CPU を意識しなくてよい。
+
+#if !defined(KK_DISABLE_CPU_DISPATCH) && \
+    (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define KK_BITOPS_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace bitops
+{
+
+    // byte 毎の popcount を 8bit x 8 に詰めたもの
+    inline uint64_t bytePopcounts(uint64_t w)
+    {
+        uint64_t s = w - ((w >> 1) & 0x5555555555555555ULL);
+        s = (s & 0x3333333333333333ULL) + ((s >> 2) & 0x3333333333333333ULL);
+        return (s + (s >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    }
+
+    inline int popcount64(uint64_t w)
+    {
+#if defined(__POPCNT__)
+        return std::popcount(w);
+#else
+        return static_cast<int>((bytePopcounts(w) * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    // 可搬版: byte 単位の累積和で byte を特定し、byte 内は最大 7 回の下位ビット消去
+    inline int selectInWordPortable(uint64_t w, int r)
+    {
+        const uint64_t prefix = bytePopcounts(w) * 0x0101010101010101ULL; // inclusive prefix per byte
+        int byte = 0;
+        while (byte < 7 && static_cast<int>((prefix >> (8 * byte)) & 0xFF) <= r)
+            ++byte;
+
+        const int before = byte == 0 ? 0 : static_cast<int>((prefix >> (8 * (byte - 1))) & 0xFF);
+        uint64_t b = (w >> (8 * byte)) & 0xFF;
+        for (int i = before; i < r; ++i)
+            b &= b - 1;
+        return 8 * byte + std::countr_zero(b);
+    }
+
+    inline uint64_t popcountWordsPortable(const uint64_t *words, size_t n)
+    {
+        uint64_t c = 0;
+        for (size_t i = 0; i < n; ++i)
+            c += static_cast<uint64_t>(popcount64(words[i]));
+        return c;
+    }
+
+#ifdef KK_BITOPS_X86_DISPATCH
+    __attribute__((target("bmi,bmi2"))) inline int selectInWordBmi2(uint64_t w, int r)
+    {
+        return static_cast<int>(_tzcnt_u64(_pdep_u64(1ULL << r, w)));
+    }
+
+    __attribute__((target("popcnt"))) inline uint64_t popcountWordsPopcnt(const uint64_t *words, size_t n)
+    {
+        uint64_t c = 0;
+        for (size_t i = 0; i < n; ++i)
+            c += static_cast<uint64_t>(_mm_popcnt_u64(words[i]));
+        return c;
+    }
+
+    struct CpuFeatures
+    {
+        bool bmi2;
+        bool popcnt;
+    };
+
+    inline const CpuFeatures &cpuFeatures()
+    {
+        static const CpuFeatures f = []
+        {
+            __builtin_cpu_init();
+            return CpuFeatures{__builtin_cpu_supports("bmi2") != 0,
+                               __builtin_cpu_supports("popcnt") != 0};
+        }();
+        return f;
+    }
+#endif
+
+    // w の r 番目(0-indexed)の 1 の位置。r < popcount(w) であること。
+    inline int selectInWord(uint64_t w, int r)
+    {
+#ifdef KK_BITOPS_X86_DISPATCH
+        if (cpuFeatures().bmi2)
+            return selectInWordBmi2(w, r);
+#endif
+        return selectInWordPortable(w, r);
+    }
+
+    inline uint64_t popcountWords(const uint64_t *words, size_t n)
+    {
+#ifdef KK_BITOPS_X86_DISPATCH
+        if (cpuFeatures().popcnt)
+            return popcountWordsPopcnt(words, n);
+#endif
+        return popcountWordsPortable(words, n);
+    }
+
+} // namespace bitops
@@ -1,9 +1,12 @@
 #pragma once
+#include <bit>
 #include <cstdint>
 #include <cstddef>
 #include <vector>
 #include <stdexcept>
 
+#include "common/bit_ops_utf16.hpp"
+
 class BitVector
 {
 public:
@@ -97,43 +100,99 @@ private:
             words_.resize(need, 0ULL);
     }
 
-    static int popcount64(uint64_t x)
-    {
-        return __builtin_popcountll(x);
-    }
-
     int rank1_internal(size_t idx) const
     {
         const size_t full_words = idx >> 6;
         const size_t bit_in_word = idx & 63;
 
-        int count = 0;
-        for (size_t w = 0; w < full_words; ++w)
-        {
-            count += popcount64(words_[w]);
-        }
+        int count = static_cast<int>(bitops::popcountWords(words_.data(), full_words));
 
         const uint64_t mask =
             (bit_in_word == 63) ? ~0ULL : ((1ULL << (bit_in_word + 1)) - 1ULL);
 
-        count += popcount64(words_[full_words] & mask);
+        count += bitops::popcount64(words_[full_words] & mask);
         return count;
     }
 
+    // word 単位で数えて、該当 word の中だけ selectInWord で位置を求める
     int select_internal(bool value, int nodeId) const
     {
         if (nodeId <= 0)
             return -1;
-        int count = 0;
-        for (size_t i = 0; i < nbits_; ++i)
+        int remaining = nodeId;
+        for (size_t w = 0; w < words_.size(); ++w)
         {
-            if (get(i) == value)
-            {
-                ++count;
-                if (count == nodeId)
-                    return static_cast<int>(i);
-            }
+            uint64_t x = value ? words_[w] : ~words_[w];
+            const size_t valid = nbits_ - w * 64;
+            if (valid < 64)
+                x &= (1ULL << valid) - 1ULL;
+
+            const int c = bitops::popcount64(x);
+            if (c >= remaining)
+                return static_cast<int>(w * 64) + bitops::selectInWord(x, remaining - 1);
+            remaining -= c;
         }
         return -1;
     }
 };
+
+// BitVector と同じ words 配置のビット列への読み取り専用ビュー。
+// BitVector の words バッファ、またはマップしたファイル内の words を指す。
+// 指し先の寿命は所有者側で管理すること。
+class BitVectorView
+{
+public:
+    BitVectorView() = default;
+
+    BitVectorView(const uint64_t *words, size_t nbits)
+        : words_(words), nbits_(nbits)
+    {
+    }
+
+    explicit BitVectorView(const BitVector &bv)
+        : words_(bv.words().data()), nbits_(bv.size())
+    {
+    }
+
+    size_t size() const { return nbits_; }
+    size_t numWords() const { return (nbits_ + 63) / 64; }
+    const uint64_t *words() const { return words_; }
+
+    bool get(size_t i) const
+    {
+        if (i >= nbits_)
+            return false;
+        return (words_[i >> 6] >> (i & 63)) & 1ULL;
+    }
+
+    // 1 の総数 (最後の word の範囲外のビットは数えない)
+    size_t countOnes() const
+    {
+        const size_t full = nbits_ >> 6;
+        size_t count = static_cast<size_t>(bitops::popcountWords(words_, full));
+        if ((nbits_ & 63) != 0)
+            count += static_cast<size_t>(bitops::popcount64(words_[full] & ((1ULL << (nbits_ & 63)) - 1)));
+        return count;
+    }
+
+    // i から続く 1 の個数（i が 0 または範囲外なら 0）。word 単位で数える。
+    size_t onesRun(size_t i) const
+    {
+        if (i >= nbits_)
+            return 0;
+        size_t j = i;
+        while (j < nbits_)
+        {
+            const size_t off = j & 63;
+            const size_t ones = static_cast<size_t>(std::countr_one(words_[j >> 6] >> off));
+            j += ones;
+            if (ones < 64 - off)
+                break;
+        }
+        return (j < nbits_ ? j : nbits_) - i;
+    }
+
+private:
+    const uint64_t *words_{nullptr};
+    size_t nbits_{0};
+};
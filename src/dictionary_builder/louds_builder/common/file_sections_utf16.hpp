@@ -0,0 +1,179 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Optional tagged sections appended after the regular payload of a binary
+// artifact (.louds, token_array.bin, ...).
+//
+// Layout (all little-endian, every section starts 8-byte aligned):
+//   [regular payload][zero padding to 8]
+//   sectionsStart:
+//     repeat { u32 tag; u32 reserved(0); u64 len; u8 data[len]; zero padding to 8 }
+//   u64 sectionsStart
+//   u64 kMagic
+//
+// The footer sits at the very end of the file, so a reader can find the
+// sections without understanding the whole payload, and readers that stop
+// after the payload they know (older builds) simply never look at it.
+// Files without the footer are treated as having no sections.
+class FileSections
+{
+public:
+    static constexpr uint64_t kMagic = 0x3130544345534B4BULL; // "KKSECT01"
+
+    // Tags are global so that the same meaning keeps the same number in every artifact.
+    enum Tag : uint32_t
+    {
+        kLbsIndex = 1,      // SuccinctBitVector index of LBS
+        kPostingsIndex = 2, // SuccinctBitVector index of TokenArray::postingsBits
+        kLeafRankTermIds = 3, // .louds with termId: termIdByNodeId omitted, termId = rank1(isLeaf, pos) - 1;
+                              // data is the SuccinctBitVector index of isLeaf (may be empty)
+        kLabels8 = 4,         // .louds with termId: labels as 8-bit codes (AlphabetLabelsUtf16), labels array empty
+        kPredictCosts = 5,    // .louds with termId: per-subtree / per-leaf minimum word cost for predictive search
+        kParents = 6,         // .louds (tango): parent label index and depth per node for getLetter (ParentTableUtf16)
+        kSurfaceIds = 7,      // token_array.bin: u64 n, i32 SurfacePool id per token (-1 for kana sentinels)
+        kPostingOffsets = 8,  // token_array.bin: u64 n, u32 first token of each termId (n = terms + 1)
+        kSortedPostings = 9,  // token_array.bin: no data; each posting list is sorted by wordCost (ascending)
+    };
+
+    bool empty() const { return sections_.empty(); }
+
+    void add(uint32_t tag, std::vector<uint8_t> data)
+    {
+        sections_.emplace_back(tag, std::move(data));
+    }
+
+    // Returns nullptr if the tag is absent.
+    const std::vector<uint8_t> *find(uint32_t tag) const
+    {
+        for (const auto &s : sections_)
+        {
+            if (s.first == tag)
+                return &s.second;
+        }
+        return nullptr;
+    }
+
+    // Appends padding, the sections and the footer at the current position.
+    void write(std::ostream &os) const
+    {
+        uint64_t pos = static_cast<uint64_t>(os.tellp());
+        pos += pad(os, pos);
+
+        const uint64_t start = pos;
+        for (const auto &s : sections_)
+        {
+            const uint32_t tag = s.first;
+            const uint32_t reserved = 0;
+            const uint64_t len = static_cast<uint64_t>(s.second.size());
+            os.write(reinterpret_cast<const char *>(&tag), sizeof(tag));
+            os.write(reinterpret_cast<const char *>(&reserved), sizeof(reserved));
+            os.write(reinterpret_cast<const char *>(&len), sizeof(len));
+            if (len > 0)
+                os.write(reinterpret_cast<const char *>(s.second.data()), static_cast<std::streamsize>(len));
+            pos += 16 + len;
+            pos += pad(os, pos);
+        }
+
+        const uint64_t magic = kMagic;
+        os.write(reinterpret_cast<const char *>(&start), sizeof(start));
+        os.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+    }
+
+    // Reads the sections of a file via its footer. The stream position is
+    // left unspecified. Returns an empty set for files without sections.
+    static FileSections read(std::istream &is)
+    {
+        FileSections out;
+        is.clear();
+        is.seekg(0, std::ios::end);
+        const std::streamoff size = is.tellg();
+        if (size < 16)
+            return out;
+
+        uint64_t start = 0;
+        uint64_t magic = 0;
+        is.seekg(size - 16);
+        is.read(reinterpret_cast<char *>(&start), sizeof(start));
+        is.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+        if (!is || magic != kMagic || start > static_cast<uint64_t>(size - 16))
+        {
+            is.clear();
+            return out;
+        }
+
+        std::vector<uint8_t> buf(static_cast<size_t>(static_cast<uint64_t>(size - 16) - start));
+        is.seekg(static_cast<std::streamoff>(start));
+        if (!buf.empty())
+            is.read(reinterpret_cast<char *>(buf.data()), static_cast<std::streamsize>(buf.size()));
+        if (!is)
+        {
+            is.clear();
+            return out;
+        }
+
+        forEach(buf.data(), buf.size(), [&](uint32_t tag, const uint8_t *data, size_t len)
+                { out.add(tag, std::vector<uint8_t>(data, data + len)); });
+        return out;
+    }
+
+    // Zero-copy lookup in a whole file image (e.g. a MappedFile). The returned
+    // span points into file and keeps its 8-byte alignment.
+    static std::optional<std::span<const uint8_t>> locate(const uint8_t *file, size_t size, uint32_t tag)
+    {
+        if (size < 16)
+            return std::nullopt;
+
+        uint64_t start = 0;
+        uint64_t magic = 0;
+        std::memcpy(&start, file + size - 16, sizeof(start));
+        std::memcpy(&magic, file + size - 8, sizeof(magic));
+        if (magic != kMagic || start > static_cast<uint64_t>(size - 16))
+            return std::nullopt;
+
+        std::optional<std::span<const uint8_t>> found;
+        forEach(file + start, size - 16 - static_cast<size_t>(start),
+                [&](uint32_t t, const uint8_t *data, size_t len)
+                {
+                    if (t == tag && !found)
+                        found = std::span<const uint8_t>(data, len);
+                });
+        return found;
+    }
+
+private:
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> sections_;
+
+    template <class F>
+    static void forEach(const uint8_t *buf, size_t size, F f)
+    {
+        size_t p = 0;
+        while (p + 16 <= size)
+        {
+            uint32_t tag = 0;
+            uint64_t len = 0;
+            std::memcpy(&tag, buf + p, sizeof(tag));
+            std::memcpy(&len, buf + p + 8, sizeof(len));
+            p += 16;
+            if (len > size - p)
+                break; // truncated: keep what we have
+            f(tag, buf + p, static_cast<size_t>(len));
+            p += static_cast<size_t>((len + 7) & ~uint64_t{7});
+        }
+    }
+
+    static uint64_t pad(std::ostream &os, uint64_t pos)
+    {
+        static const char zeros[8] = {};
+        const uint64_t n = (8 - (pos & 7)) & 7;
+        if (n > 0)
+            os.write(zeros, static_cast<std::streamsize>(n));
+        return n;
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// LOUDS の兄弟ラベル検索。
+//
+// Converter は子をラベル昇順に並べるので、あるノードの子のラベルは
+// labels[first, first + n) に昇順で連続して並ぶ。
+// findSorted はこの区間から c を探し、区間内の位置 (0-indexed) を返す。
+// - 長い区間 (ルート付近のかな 80 字前後) は二分探索で kScanWidth 以下に絞る
+// - 残りは SSE2 (x86-64 の GCC/Clang では常に使える) で 8 ラベルずつ比較、それ以外は逐次比較
+//   (KK_DISABLE_CPU_DISPATCH 定義時も逐次比較)
+
+#if !defined(KK_DISABLE_CPU_DISPATCH) && defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define KK_LABELOPS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace labelops
+{
+
+    inline constexpr size_t kScanWidth = 16;
+
+    inline int scanLinear(const char16_t *p, size_t n, char16_t c)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (p[i] == c)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    inline int scan(const char16_t *p, size_t n, char16_t c)
+    {
+#ifdef KK_LABELOPS_SSE2
+        size_t i = 0;
+        const __m128i key = _mm_set1_epi16(static_cast<short>(c));
+        for (; i + 8 <= n; i += 8)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(v, key)));
+            if (mask != 0)
+                return static_cast<int>(i) + __builtin_ctz(mask) / 2;
+        }
+        const int tail = scanLinear(p + i, n - i, c);
+        return tail < 0 ? -1 : static_cast<int>(i) + tail;
+#else
+        return scanLinear(p, n, c);
+#endif
+    }
+
+    // labels[first, first + n) (昇順) の中の c の位置。無ければ -1。
+    // 区間が labels をはみ出す分は切り詰める。
+    inline int findSorted(std::span<const char16_t> labels, size_t first, size_t n, char16_t c)
+    {
+        if (first >= labels.size())
+            return -1;
+        if (n > labels.size() - first)
+            n = labels.size() - first;
+
+        const char16_t *base = labels.data() + first;
+        size_t lo = 0;
+        size_t hi = n;
+        while (hi - lo > kScanWidth)
+        {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (base[mid] < c)
+                lo = mid + 1;
+            else
+                hi = mid + 1; // base[mid] >= c: 答えは [lo, mid]
+        }
+        const int k = scan(base + lo, hi - lo, c);
+        return k < 0 ? -1 : static_cast<int>(lo) + k;
+    }
+
+} // namespace labelops
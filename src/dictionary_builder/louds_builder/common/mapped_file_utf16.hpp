@@ -0,0 +1,173 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/bit_vector_utf16.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define KK_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ファイル全体の読み取り専用マッピング。
+//
+// 読み込み側 (LOUDSReaderUtf16::mapFromFile など) は、このマッピング内を直接指す
+// ビューで動作する。ページキャッシュを共有するので、同じ辞書を開く複数プロセスでも
+// 物理メモリは 1 つ分で済み、起動時のコピーも発生しない。
+// mmap の無い環境では 8byte 境界のヒープバッファに読み込んで同じインターフェースを提供する。
+//
+// 所有者は shared_ptr で保持し、ビューを持つオブジェクトより長生きさせること。
+class MappedFile
+{
+public:
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+#ifdef KK_HAVE_MMAP
+        if (map_ != nullptr)
+            ::munmap(map_, size_);
+#endif
+    }
+
+    static std::shared_ptr<const MappedFile> open(const std::string &path)
+    {
+        std::shared_ptr<MappedFile> f(new MappedFile());
+#ifdef KK_HAVE_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("failed to open file for read: " + path);
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("failed to stat file: " + path);
+        }
+
+        f->size_ = static_cast<size_t>(st.st_size);
+        if (f->size_ > 0)
+        {
+            void *p = ::mmap(nullptr, f->size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("failed to mmap file: " + path);
+            }
+            f->map_ = p;
+            f->data_ = static_cast<const uint8_t *>(p);
+        }
+        ::close(fd);
+#else
+        std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+        if (!ifs)
+            throw std::runtime_error("failed to open file for read: " + path);
+        f->size_ = static_cast<size_t>(ifs.tellg());
+        f->fallback_.resize((f->size_ + 7) / 8);
+        ifs.seekg(0);
+        if (f->size_ > 0)
+            ifs.read(reinterpret_cast<char *>(f->fallback_.data()), static_cast<std::streamsize>(f->size_));
+        if (!ifs)
+            throw std::runtime_error("failed to read file: " + path);
+        f->data_ = reinterpret_cast<const uint8_t *>(f->fallback_.data());
+#endif
+        return f;
+    }
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t *data_{nullptr};
+    size_t size_{0};
+#ifdef KK_HAVE_MMAP
+    void *map_{nullptr};
+#else
+    std::vector<uint64_t> fallback_;
+#endif
+};
+
+// マップしたバイト列を先頭から読む。配列は境界と型のアラインメントを検査した上で
+// コピーせずに span として返す。形式に合わない場合は std::runtime_error。
+class MappedReader
+{
+public:
+    MappedReader(const uint8_t *data, size_t size, std::string what)
+        : data_(data), size_(size), what_(std::move(what))
+    {
+    }
+
+    size_t pos() const { return pos_; }
+    size_t remaining() const { return size_ - pos_; }
+
+    uint64_t u64() { return scalar<uint64_t>(); }
+    uint32_t u32() { return scalar<uint32_t>(); }
+
+    template <class T>
+    std::span<const T> array(size_t n)
+    {
+        if (n > remaining() / sizeof(T))
+            fail("truncated array");
+        const uint8_t *p = data_ + pos_;
+        if (n > 0 && reinterpret_cast<uintptr_t>(p) % alignof(T) != 0)
+            fail("misaligned array");
+        pos_ += n * sizeof(T);
+        return std::span<const T>(reinterpret_cast<const T *>(p), n);
+    }
+
+    // BitVector の保存形式 (u64 nbits, u64 wordCount, u64 words[]) をビューとして読む
+    BitVectorView bits()
+    {
+        const uint64_t nbits = u64();
+        const uint64_t nwords = u64();
+        if (nwords != (nbits + 63) / 64)
+            fail("bit vector size mismatch");
+        const auto words = array<uint64_t>(static_cast<size_t>(nwords));
+        return BitVectorView(words.data(), static_cast<size_t>(nbits));
+    }
+
+    // 次の a byte 境界 (ファイル先頭基準) まで進める
+    void align(size_t a)
+    {
+        const size_t next = (pos_ + a - 1) / a * a;
+        if (next > size_)
+            fail("truncated padding");
+        pos_ = next;
+    }
+
+    [[noreturn]] void fail(const std::string &msg) const
+    {
+        throw std::runtime_error(what_ + ": " + msg + " at offset " + std::to_string(pos_));
+    }
+
+private:
+    const uint8_t *data_;
+    size_t size_;
+    size_t pos_{0};
+    std::string what_;
+
+    template <class T>
+    T scalar()
+    {
+        if (remaining() < sizeof(T))
+            fail("truncated");
+        T v;
+        std::memcpy(&v, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return v;
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// 固定幅 (0..32 bit) の非負整数列を u64 word に詰めたもの。
+//
+// - pack() は値 i を bit [i * width, (i + 1) * width) に置き、末尾に番兵の
+//   word を 1 つ足す (get が境界をまたぐときに次の word を無条件で読めるように)
+// - PackedIntsView は word 列を参照するだけで、マップしたファイルの中を直接読める
+// - width == 0 はすべて 0 の列 (word は番兵のみ)
+//
+// 保存形式は u64 width, u64 n, u64 wordCount, u64 words[] (BitVector と同じく 8 バイト境界)。
+namespace packedints
+{
+
+    // maxValue を表すのに要る bit 数
+    inline uint32_t widthFor(uint64_t maxValue)
+    {
+        uint32_t w = 0;
+        while (w < 64 && (maxValue >> w) != 0)
+            ++w;
+        return w;
+    }
+
+    inline std::vector<uint64_t> pack(std::span<const uint32_t> values, uint32_t width)
+    {
+        std::vector<uint64_t> words((values.size() * width + 63) / 64 + 1, 0);
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            const uint64_t v = values[i];
+            const size_t bit = i * width;
+            const size_t w = bit >> 6;
+            const size_t off = bit & 63;
+            words[w] |= v << off;
+            if (off + width > 64)
+                words[w + 1] |= v >> (64 - off);
+        }
+        return words;
+    }
+
+} // namespace packedints
+
+class PackedIntsView
+{
+public:
+    PackedIntsView() = default;
+    PackedIntsView(std::span<const uint64_t> words, uint32_t width, size_t n)
+        : words_(words), width_(width), n_(n)
+    {
+    }
+
+    size_t size() const { return n_; }
+    uint32_t width() const { return width_; }
+    size_t bytes() const { return words_.size() * sizeof(uint64_t); }
+
+    // 呼び出し側が i < size() を保証すること
+    uint32_t get(size_t i) const
+    {
+        if (width_ == 0)
+            return 0;
+        const size_t bit = i * width_;
+        const size_t w = bit >> 6;
+        const size_t off = bit & 63;
+        uint64_t v = words_[w] >> off;
+        if (off + width_ > 64)
+            v |= words_[w + 1] << (64 - off);
+        return static_cast<uint32_t>(v & ((uint64_t{1} << width_) - 1));
+    }
+
+private:
+    std::span<const uint64_t> words_;
+    uint32_t width_{0};
+    size_t n_{0};
+};
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "common/bit_vector_utf16.hpp"
+#include "common/packed_ints_utf16.hpp"
+
+// LOUDS の各ノードの親と深さを、ラベル番号 (rank1(LBS, pos)) で引く表
+// (FileSections::kParents)。
+//
+// getLetter はノードから根へ 1 歩ずつ上り、1 歩ごとに rank0 + select1 を引く。
+// 単語の表層文字列を復元するたびにこれを文字数分くり返すので、親を表で持つ。
+// - parent(L): ラベル番号 L のノードの親のラベル番号 (= rank0(LBS, pos))。
+//   根 (L == 1) とダミー (L == 0) は 0
+// - depth(L) : 根からの文字数 (根は 0)。出力の長さを先に決めて後ろから埋める
+// nodeIndex (LBS 上の位置) の意味は変えないので、TokenArray はそのまま使える。
+//
+// LBS だけから 1 回の走査で作れる (serialize)。ファイルに無ければ読み込み時に
+// 作ってもよい。
+//
+// 保存形式: parent, depth の順に packed 列 (u64 width, u64 n, u64 wordCount, u64 words[])。
+// 8 バイト境界なので、マップしたファイルの中を直接読む。
+class ParentTableUtf16
+{
+public:
+    bool empty() const { return parent_.size() == 0; }
+    size_t size() const { return parent_.size(); }
+    size_t bytes() const { return parent_.bytes() + depth_.bytes(); }
+
+    // 呼び出し側が L < size() を保証すること
+    uint32_t parent(size_t L) const { return parent_.get(L); }
+    uint32_t depth(size_t L) const { return depth_.get(L); }
+
+    static std::vector<uint8_t> serialize(BitVectorView lbs)
+    {
+        // 位置 0 が根の 1、位置 1 がその 0。以後、1 は直前までの 0 の数 (= 親のラベル番号) の子
+        std::vector<uint32_t> parent{0, 0};
+        std::vector<uint32_t> depth{0, 0};
+        uint32_t zeros = 0;
+        for (size_t pos = 1; pos < lbs.size(); ++pos)
+        {
+            if (!lbs.get(pos))
+            {
+                ++zeros;
+                continue;
+            }
+            parent.push_back(zeros);
+            depth.push_back(depth[zeros] + 1);
+        }
+
+        std::vector<uint8_t> out;
+        append(out, parent);
+        append(out, depth);
+        return out;
+    }
+
+    // section をその場で参照する (section は表より長く生きること)。壊れていれば false。
+    bool view(std::span<const uint8_t> section)
+    {
+        size_t p = 0;
+        PackedIntsView parent;
+        PackedIntsView depth;
+        if (!take(section, p, parent) || !take(section, p, depth) || parent.size() != depth.size())
+            return false;
+        parent_ = parent;
+        depth_ = depth;
+        return true;
+    }
+
+    // bytes を持ち込んで参照する。move しても vector の中身は動かないのでビューはそのまま。
+    bool adopt(std::vector<uint8_t> bytes)
+    {
+        store_ = std::move(bytes);
+        return view(store_);
+    }
+
+private:
+    std::vector<uint8_t> store_; // adopt したときだけ
+    PackedIntsView parent_;
+    PackedIntsView depth_;
+
+    static void append(std::vector<uint8_t> &out, const std::vector<uint32_t> &values)
+    {
+        uint32_t maxValue = 0;
+        for (uint32_t v : values)
+            maxValue = v > maxValue ? v : maxValue;
+        const uint32_t width = packedints::widthFor(maxValue);
+        const std::vector<uint64_t> words = packedints::pack(values, width);
+
+        const uint64_t header[3] = {width, values.size(), words.size()};
+        const auto *hp = reinterpret_cast<const uint8_t *>(header);
+        out.insert(out.end(), hp, hp + sizeof(header));
+        const auto *wp = reinterpret_cast<const uint8_t *>(words.data());
+        out.insert(out.end(), wp, wp + words.size() * sizeof(uint64_t));
+    }
+
+    static bool take(std::span<const uint8_t> section, size_t &p, PackedIntsView &out)
+    {
+        uint64_t header[3] = {0, 0, 0};
+        if (section.size() - p < sizeof(header))
+            return false;
+        std::memcpy(header, section.data() + p, sizeof(header));
+        p += sizeof(header);
+
+        const uint64_t width = header[0];
+        const uint64_t n = header[1];
+        const uint64_t wordN = header[2];
+        if (width > 32 || wordN != (n * width + 63) / 64 + 1 || wordN > (section.size() - p) / sizeof(uint64_t))
+            return false;
+        out = PackedIntsView({reinterpret_cast<const uint64_t *>(section.data() + p), static_cast<size_t>(wordN)},
+                             static_cast<uint32_t>(width), static_cast<size_t>(n));
+        p += static_cast<size_t>(wordN) * sizeof(uint64_t);
+        return true;
+    }
+};
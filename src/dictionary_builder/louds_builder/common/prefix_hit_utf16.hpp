@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+// One hit of a fused common-prefix search over a yomi trie: key[0, length) is a
+// terminal node. Shared by the yomi backends (LOUDSWithTermIdReaderUtf16,
+// DoubleArrayReaderUtf16) so callers can switch between them.
+struct PrefixHitUtf16
+{
+    uint32_t length;
+    int32_t termId; // -1 if the terminal node carries no termId
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// LOUDS のルートから 1〜2 文字目までの遷移を直接引く表。
+//
+// 変換時の commonPrefixSearch はほぼ毎回ルートから始まり、最初の 1〜2 歩
+// (ルート直下はかな全体に近い分岐) で rank/select を使う。ここを表引きにする。
+// - ひらがなブロック (U+3040..U+309F) は 96 要素の密な表
+//   (1 文字目: level1_, 1・2 文字目が共にひらがな: level2_ の 96x96)
+// - それ以外の文字を含む遷移は (キー, 位置) のソート済み配列を二分探索
+// 値は LBS 上の位置 (traverse の戻り値と同じ)、無ければ -1。
+//
+// 読み込み時に build() で作る (ファイルには持たない)。位置だけを持つので
+// 所有者と一緒に move してよい。
+class RootDispatchUtf16
+{
+public:
+    static constexpr char16_t kBase = 0x3040;
+    static constexpr size_t kSize = 0x60;
+
+    bool empty() const { return level1_.empty(); }
+
+    // children(pos) は pos の子を (ラベル, 位置) の列で返す。
+    template <class Children>
+    void build(Children children)
+    {
+        level1_.assign(kSize, -1);
+        level2_.assign(kSize * kSize, -1);
+        fallback1_.clear();
+        fallback2_.clear();
+
+        for (const auto &[c1, pos1] : children(0))
+        {
+            if (isDense(c1))
+                level1_[slot(c1)] = pos1;
+            else
+                fallback1_.emplace_back(c1, pos1);
+
+            for (const auto &[c2, pos2] : children(pos1))
+            {
+                if (isDense(c1) && isDense(c2))
+                    level2_[slot(c1) * kSize + slot(c2)] = pos2;
+                else
+                    fallback2_.emplace_back(pairKey(c1, c2), pos2);
+            }
+        }
+        std::sort(fallback1_.begin(), fallback1_.end());
+        std::sort(fallback2_.begin(), fallback2_.end());
+    }
+
+    // key[0, 1) のノード位置
+    int lookup1(char16_t c) const
+    {
+        if (isDense(c))
+            return level1_[slot(c)];
+        return find(fallback1_, c);
+    }
+
+    // key[0, 2) のノード位置
+    int lookup2(char16_t c1, char16_t c2) const
+    {
+        if (isDense(c1) && isDense(c2))
+            return level2_[slot(c1) * kSize + slot(c2)];
+        return find(fallback2_, pairKey(c1, c2));
+    }
+
+    size_t memoryBytes() const
+    {
+        return (level1_.size() + level2_.size()) * sizeof(int32_t) +
+               fallback1_.size() * sizeof(fallback1_[0]) + fallback2_.size() * sizeof(fallback2_[0]);
+    }
+
+private:
+    static bool isDense(char16_t c) { return c >= kBase && c < kBase + kSize; }
+    static size_t slot(char16_t c) { return static_cast<size_t>(c - kBase); }
+    static uint32_t pairKey(char16_t c1, char16_t c2) { return (static_cast<uint32_t>(c1) << 16) | c2; }
+
+    template <class K>
+    static int find(const std::vector<std::pair<K, int32_t>> &v, K key)
+    {
+        const auto it = std::lower_bound(v.begin(), v.end(), key,
+                                         [](const auto &e, K k)
+                                         { return e.first < k; });
+        return (it != v.end() && it->first == key) ? it->second : -1;
+    }
+
+    std::vector<int32_t> level1_;
+    std::vector<int32_t> level2_;
+    std::vector<std::pair<char16_t, int32_t>> fallback1_;
+    std::vector<std::pair<uint32_t, int32_t>> fallback2_;
+};
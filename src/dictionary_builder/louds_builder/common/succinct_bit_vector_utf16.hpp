@@ -1,31 +1,139 @@
 #pragma once
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
 #include <vector>
-#include <algorithm>
 
+#include "common/bit_ops_utf16.hpp"
 #include "common/bit_vector_utf16.hpp"
 
-// Kotlin の SuccinctBitVector 相当。
-// - big block: 256 bits
-// - small block: 8 bits
-// - rank1/rank0: O(1) + 最大8bitの走査
-// - select1/select0: 大ブロック二分探索 + 小ブロック線形 + 最大8bit走査
+// Kotlin の SuccinctBitVector 相当（rank9 レイアウト）。
+// - basic block: 512 bits (= 64bit word x 8)
+// - rankDir_[2b]   : block b 開始時点の累積 ones (64bit)
+// - rankDir_[2b+1] : block 内 word 1..7 の開始時点の相対 ones を 9bit x 7 で詰めたもの
+// - rank1/rank0: 16byte の rankDir_ 1 エントリ + popcount 1 回で O(1)
+// - word 内 select / popcount は common/bit_ops_utf16.hpp（BMI2/POPCNT 実行時切替）
+// - select1/select0: 512 個おきの 1/0 が属する block をサンプリングしたヒントで
+//   候補 block 範囲を絞り、その範囲を探索 + 9bit カウンタで word 特定 + word 内走査
+//   (ヒント無しで構築した場合は全 block の二分探索)
+//
+// 索引（rankDir_ と select ヒント）は serializeIndex() でバイト列にでき、
+// adopt() で再計算せずに取り込める（FileSections で成果物に同梱する用途）。
+// adoptView() はコピーせずバイト列 (マップしたファイル内) を直接参照する。
+//
+// 元の BitVector の words バッファを指すだけで、ビット列自体は保持しない。
+// words バッファは所有者の move では動かないので、所有者クラスは
+// BitVector と一緒に move してよい（copy は別バッファになるので不可）。
+// 索引は自前の vector か外部バッファを span で参照する。copy 時は自前分だけ付け替える。
 class SuccinctBitVector
 {
 public:
-    explicit SuccinctBitVector(const BitVector &bv)
-        : bv_(bv),
-          n_(static_cast<int>(bv.size())),
-          bigBlockRanks_(),
-          smallBlockRanks_(),
+    SuccinctBitVector() = default;
+
+    explicit SuccinctBitVector(const BitVector &bv, bool withSelectHints = true)
+        : SuccinctBitVector(BitVectorView(bv), withSelectHints)
+    {
+    }
+
+    explicit SuccinctBitVector(BitVectorView bits, bool withSelectHints = true)
+        : words_(bits.words()),
+          n_(static_cast<int>(bits.size())),
           totalOnes_(0)
     {
         build();
+        if (withSelectHints)
+            buildSelectHints();
+    }
+
+    SuccinctBitVector(const SuccinctBitVector &other) { *this = other; }
+
+    SuccinctBitVector &operator=(const SuccinctBitVector &other)
+    {
+        if (this == &other)
+            return *this;
+        words_ = other.words_;
+        n_ = other.n_;
+        nWords_ = other.nWords_;
+        totalOnes_ = other.totalOnes_;
+        rankDirStore_ = other.rankDirStore_;
+        select1Store_ = other.select1Store_;
+        select0Store_ = other.select0Store_;
+        rankDir_ = rebind(other.rankDir_, other.rankDirStore_, rankDirStore_);
+        select1Hints_ = rebind(other.select1Hints_, other.select1Store_, select1Store_);
+        select0Hints_ = rebind(other.select0Hints_, other.select0Store_, select0Store_);
+        return *this;
+    }
+
+    SuccinctBitVector(SuccinctBitVector &&) noexcept = default;
+    SuccinctBitVector &operator=(SuccinctBitVector &&) noexcept = default;
+
+    // Uses a persisted index (from serializeIndex) when it matches bv,
+    // otherwise builds one from scratch. The index bytes are copied.
+    static SuccinctBitVector adopt(const BitVector &bv, const std::vector<uint8_t> *index)
+    {
+        if (index)
+        {
+            SuccinctBitVector s;
+            s.words_ = bv.words().data();
+            s.n_ = static_cast<int>(bv.size());
+            if (s.parseIndex(std::span<const uint8_t>(*index), /*copy=*/true))
+                return s;
+        }
+        return SuccinctBitVector(bv);
+    }
+
+    // Same as adopt(), but references the index bytes in place (e.g. inside a
+    // MappedFile), so they must outlive the result. withSelectHints only applies
+    // when the index has to be rebuilt.
+    static SuccinctBitVector adoptView(BitVectorView bits, std::optional<std::span<const uint8_t>> index,
+                                       bool withSelectHints = true)
+    {
+        if (index)
+        {
+            SuccinctBitVector s;
+            s.words_ = bits.words();
+            s.n_ = static_cast<int>(bits.size());
+            if (s.parseIndex(*index, /*copy=*/false))
+                return s;
+        }
+        return SuccinctBitVector(bits, withSelectHints);
+    }
+
+    // u64 nbits, u64 totalOnes, then rankDir_ / select1Hints_ / select0Hints_
+    // each as (u64 count, elements, zero padding to 8 bytes).
+    std::vector<uint8_t> serializeIndex() const
+    {
+        // Sized once up front; each field is then copied in at a running offset.
+        std::vector<uint8_t> out(2 * sizeof(uint64_t) + arrayBytes(rankDir_) + arrayBytes(select1Hints_) +
+                                 arrayBytes(select0Hints_));
+        size_t pos = 0;
+        put_u64(out, pos, static_cast<uint64_t>(n_));
+        put_u64(out, pos, static_cast<uint64_t>(totalOnes_));
+        put_array(out, pos, rankDir_);
+        put_array(out, pos, select1Hints_);
+        put_array(out, pos, select0Hints_);
+        return out;
     }
 
     int size() const { return n_; }
     int totalOnes() const { return totalOnes_; }
 
+    // rank directory + select hints (the bits themselves are not counted)
+    size_t indexSizeInBytes() const
+    {
+        return rankDir_.size() * sizeof(uint64_t) +
+               (select1Hints_.size() + select0Hints_.size()) * sizeof(uint32_t);
+    }
+
+    bool get(int pos) const
+    {
+        if (pos < 0 || pos >= n_)
+            return false;
+        return bit(pos);
+    }
+
     // rank1(index): 0..index (inclusive) の 1 の数
     int rank1(int index) const
     {
@@ -35,29 +143,7 @@ public:
             return 0;
         if (index >= n_)
             return totalOnes_;
-
-        const int bigIndex = index / bigBlockSize_;
-        const int offsetInBig = index % bigBlockSize_;
-        const int smallIndex = offsetInBig / smallBlockSize_;
-        const int offsetInSmall = offsetInBig % smallBlockSize_;
-
-        const int globalSmallIndex = bigIndex * numSmallBlocksPerBig_ + smallIndex;
-
-        int rankBase =
-            bigBlockRanks_[static_cast<size_t>(bigIndex)] +
-            smallBlockRanks_[static_cast<size_t>(globalSmallIndex)];
-
-        int additional = 0;
-        const int smallStart = bigIndex * bigBlockSize_ + smallIndex * smallBlockSize_;
-        for (int i = 0; i <= offsetInSmall; ++i)
-        {
-            const int pos = smallStart + i;
-            if (pos >= n_)
-                break;
-            if (bv_.get(static_cast<size_t>(pos)))
-                additional++;
-        }
-        return rankBase + additional;
+        return rank1Exclusive(static_cast<size_t>(index) + 1);
     }
 
     // rank0(index): 0..index (inclusive) の 0 の数
@@ -80,64 +166,19 @@ public:
         if (n_ <= 0)
             return -1;
 
-        // bigBlockRanks[big] は big ブロック開始時点の累積 ones
-        int lo = 0;
-        int hi = static_cast<int>(bigBlockRanks_.size()) - 1;
-        int bigBlock = 0;
-        while (lo <= hi)
-        {
-            int mid = (lo + hi) / 2;
-            if (bigBlockRanks_[static_cast<size_t>(mid)] < nodeId)
-            {
-                bigBlock = mid;
-                lo = mid + 1;
-            }
-            else
-            {
-                hi = mid - 1;
-            }
-        }
-
-        const int localTarget = nodeId - bigBlockRanks_[static_cast<size_t>(bigBlock)];
+        // 累積 ones が nodeId 未満である最後の block
+        const size_t block = findBlock(select1Hints_, nodeId, [this](size_t b)
+                                       { return onesBeforeBlock(b); });
 
-        const int baseSmallIndex = bigBlock * numSmallBlocksPerBig_;
-        const int numSmallBlocks = static_cast<int>(smallBlockRanks_.size());
-        const int smallBlocksInThisBig =
-            std::min(numSmallBlocksPerBig_, std::max(0, numSmallBlocks - baseSmallIndex));
+        int remaining = nodeId - static_cast<int>(onesBeforeBlock(block));
+        size_t k = 1;
+        while (k < kWordsPerBlock && static_cast<int>(subRank(block, k)) < remaining)
+            ++k;
+        --k;
+        remaining -= static_cast<int>(subRank(block, k));
 
-        int smallBlock = 0;
-        while (smallBlock < smallBlocksInThisBig - 1)
-        {
-            const int nextIndex = baseSmallIndex + smallBlock + 1;
-            if (smallBlockRanks_[static_cast<size_t>(nextIndex)] < localTarget)
-            {
-                smallBlock++;
-            }
-            else
-            {
-                break;
-            }
-        }
-
-        const int globalSmallIndex = baseSmallIndex + smallBlock;
-        const int offsetInSmallBlock =
-            localTarget - smallBlockRanks_[static_cast<size_t>(globalSmallIndex)];
-
-        const int smallStart = bigBlock * bigBlockSize_ + smallBlock * smallBlockSize_;
-        int count = 0;
-        for (int i = 0; i < smallBlockSize_; ++i)
-        {
-            const int pos = smallStart + i;
-            if (pos >= n_)
-                break;
-            if (bv_.get(static_cast<size_t>(pos)))
-            {
-                ++count;
-                if (count == offsetInSmallBlock)
-                    return pos;
-            }
-        }
-        return -1;
+        const size_t w = block * kWordsPerBlock + k;
+        return static_cast<int>(w * 64) + selectInWord(words_[w], remaining - 1);
     }
 
     // select0(nodeId): nodeId番目(1-indexed)の 0 の位置
@@ -149,132 +190,304 @@ public:
         if (nodeId < 1 || nodeId > totalZeros)
             return -1;
 
-        int lo = 0;
-        int hi = static_cast<int>(bigBlockRanks_.size()) - 1;
-        int bigBlock = 0;
+        const size_t block = findBlock(select0Hints_, nodeId, [this](size_t b)
+                                       { return zerosBeforeBlock(b); });
 
-        while (lo <= hi)
-        {
-            int mid = (lo + hi) / 2;
-            const int blockStart = mid * bigBlockSize_;
-            const int zerosBefore = blockStart - bigBlockRanks_[static_cast<size_t>(mid)];
-            if (zerosBefore < nodeId)
-            {
-                bigBlock = mid;
-                lo = mid + 1;
-            }
-            else
-            {
-                hi = mid - 1;
-            }
-        }
+        int remaining = nodeId - static_cast<int>(zerosBeforeBlock(block));
+        size_t k = 1;
+        while (k < kWordsPerBlock && static_cast<int>(k * 64 - subRank(block, k)) < remaining)
+            ++k;
+        --k;
+        remaining -= static_cast<int>(k * 64 - subRank(block, k));
 
-        const int zerosBeforeBlock =
-            bigBlock * bigBlockSize_ - bigBlockRanks_[static_cast<size_t>(bigBlock)];
-        const int localTarget = nodeId - zerosBeforeBlock;
+        const size_t w = block * kWordsPerBlock + k;
+        return static_cast<int>(w * 64) + selectInWord(~words_[w], remaining - 1);
+    }
 
-        const int baseSmallIndex = bigBlock * numSmallBlocksPerBig_;
-        const int numSmallBlocks = static_cast<int>(smallBlockRanks_.size());
-        const int smallBlocksInThisBig =
-            std::min(numSmallBlocksPerBig_, std::max(0, numSmallBlocks - baseSmallIndex));
+private:
+    static constexpr size_t kWordsPerBlock = 8;
+    static constexpr size_t kBlockBits = kWordsPerBlock * 64;
+
+    // select hint: every kSelectSample-th 1 (or 0) records its block
+    static constexpr int kSelectSampleShift = 9;
+    static constexpr int kSelectSample = 1 << kSelectSampleShift;
+
+    const uint64_t *words_{nullptr};
+    int n_{0};
+    size_t nWords_{0};
+
+    // 2 entries per block (interleaved so one rank touches one 16-byte slot).
+    // One extra block is appended so rank at n_ (block == nWords_/8) is valid.
+    std::span<const uint64_t> rankDir_;
+    int totalOnes_{0};
+
+    // selectXHints_[j] = block holding the (j * kSelectSample + 1)-th 1/0,
+    // followed by a sentinel (last block). Empty when built without hints.
+    std::span<const uint32_t> select1Hints_;
+    std::span<const uint32_t> select0Hints_;
+
+    // Backing storage when the index was built or copied here
+    // (empty when it is referenced in place via adoptView).
+    std::vector<uint64_t> rankDirStore_;
+    std::vector<uint32_t> select1Store_;
+    std::vector<uint32_t> select0Store_;
+
+    template <class T>
+    static std::span<const T> rebind(std::span<const T> view,
+                                     const std::vector<T> &fromStore,
+                                     const std::vector<T> &toStore)
+    {
+        if (!view.empty() && view.data() == fromStore.data())
+            return std::span<const T>(toStore);
+        return view;
+    }
 
-        int smallBlock = 0;
-        while (smallBlock < smallBlocksInThisBig - 1)
-        {
-            const int nextSmall = smallBlock + 1;
-            const int nextGlobal = baseSmallIndex + nextSmall;
-            const int onesBeforeNextSmall = smallBlockRanks_[static_cast<size_t>(nextGlobal)];
-            const int bitsBeforeNextSmall = nextSmall * smallBlockSize_;
-            const int nextZeros = bitsBeforeNextSmall - onesBeforeNextSmall;
+    bool bit(int pos) const
+    {
+        return (words_[static_cast<size_t>(pos) >> 6] >> (pos & 63)) & 1ULL;
+    }
 
-            if (nextZeros < localTarget)
-            {
-                smallBlock++;
-            }
-            else
-            {
-                break;
-            }
+    size_t numBlocks() const { return rankDir_.size() / 2; }
+
+    uint64_t onesBeforeBlock(size_t block) const { return rankDir_[2 * block]; }
+
+    uint64_t zerosBeforeBlock(size_t block) const
+    {
+        return block * kBlockBits - rankDir_[2 * block];
+    }
+
+    // Last block b with countBefore(b) < nodeId. The hints narrow the range
+    // to the blocks between two samples, which is usually one or two blocks.
+    template <class CountBefore>
+    size_t findBlock(std::span<const uint32_t> hints, int nodeId, CountBefore countBefore) const
+    {
+        size_t lo = 0;
+        size_t hi = numBlocks() - 1;
+        if (!hints.empty())
+        {
+            const size_t j = static_cast<size_t>(nodeId - 1) >> kSelectSampleShift;
+            lo = hints[j];
+            hi = hints[j + 1];
         }
 
-        const int globalSmallIndex = baseSmallIndex + smallBlock;
-        const int onesBeforeSmall = smallBlockRanks_[static_cast<size_t>(globalSmallIndex)];
-        const int bitsBeforeSmall = smallBlock * smallBlockSize_;
-        const int zerosBeforeSmall = bitsBeforeSmall - onesBeforeSmall;
-        const int offsetInSmallBlock = localTarget - zerosBeforeSmall;
+        const uint64_t target = static_cast<uint64_t>(nodeId);
+        if (hi - lo <= 8)
+        {
+            while (lo < hi && countBefore(lo + 1) < target)
+                ++lo;
+            return lo;
+        }
 
-        const int smallStart = bigBlock * bigBlockSize_ + smallBlock * smallBlockSize_;
-        int count = 0;
-        for (int i = 0; i < smallBlockSize_; ++i)
+        while (lo < hi)
         {
-            const int pos = smallStart + i;
-            if (pos >= n_)
-                break;
-            if (!bv_.get(static_cast<size_t>(pos)))
-            {
-                ++count;
-                if (count == offsetInSmallBlock)
-                    return pos;
-            }
+            const size_t mid = (lo + hi + 1) / 2;
+            if (countBefore(mid) < target)
+                lo = mid;
+            else
+                hi = mid - 1;
         }
-        return -1;
+        return lo;
     }
 
-private:
-    const BitVector &bv_;
-    int n_;
+    // ones in words [0, k) of the block (k in 0..7)
+    uint64_t subRank(size_t block, size_t k) const
+    {
+        return k == 0 ? 0 : (rankDir_[2 * block + 1] >> (9 * (k - 1))) & 0x1FFULL;
+    }
+
+    // ones in [0, pos)
+    int rank1Exclusive(size_t pos) const
+    {
+        const size_t w = pos >> 6;
+        const size_t block = w / kWordsPerBlock;
+        const uint64_t *entry = &rankDir_[2 * block];
 
-    static constexpr int bigBlockSize_ = 256;
-    static constexpr int smallBlockSize_ = 8;
-    static constexpr int numSmallBlocksPerBig_ = bigBlockSize_ / smallBlockSize_;
+        const size_t k = w % kWordsPerBlock;
+        uint64_t r = entry[0] + (k == 0 ? 0 : (entry[1] >> (9 * (k - 1))) & 0x1FFULL);
 
-    std::vector<int> bigBlockRanks_;
-    std::vector<int> smallBlockRanks_;
-    int totalOnes_;
+        const size_t off = pos & 63;
+        if (off != 0)
+            r += static_cast<uint64_t>(bitops::popcount64(words_[w] & ((1ULL << off) - 1ULL)));
+        return static_cast<int>(r);
+    }
+
+    // position (0..63) of the r-th (0-indexed) set bit of w
+    static int selectInWord(uint64_t w, int r)
+    {
+        return bitops::selectInWord(w, r);
+    }
 
     void build()
     {
+        rankDirStore_.clear();
+        rankDir_ = {};
+        totalOnes_ = 0;
         if (n_ <= 0)
+            return;
+
+        nWords_ = (static_cast<size_t>(n_) + 63) / 64;
+        const size_t blocks = nWords_ / kWordsPerBlock + 1;
+        rankDirStore_.assign(2 * blocks, 0);
+
+        uint64_t rank = 0;
+        for (size_t b = 0; b < blocks; ++b)
         {
-            bigBlockRanks_.clear();
-            smallBlockRanks_.clear();
-            totalOnes_ = 0;
+            rankDirStore_[2 * b] = rank;
+            uint64_t packed = 0;
+            uint64_t inBlock = 0;
+            for (size_t k = 0; k < kWordsPerBlock; ++k)
+            {
+                if (k > 0)
+                    packed |= inBlock << (9 * (k - 1));
+                const size_t w = b * kWordsPerBlock + k;
+                if (w < nWords_)
+                    inBlock += static_cast<uint64_t>(bitops::popcount64(words_[w]));
+            }
+            rankDirStore_[2 * b + 1] = packed;
+            rank += inBlock;
+        }
+
+        rankDir_ = rankDirStore_;
+        totalOnes_ = static_cast<int>(rank);
+    }
+
+    template <class CountBefore>
+    void buildHints(std::vector<uint32_t> &hints, int total, CountBefore countBefore) const
+    {
+        hints.clear();
+        if (total <= 0)
             return;
+
+        hints.reserve(static_cast<size_t>(total >> kSelectSampleShift) + 2);
+        size_t b = 0;
+        for (int t = 1; t <= total; t += kSelectSample)
+        {
+            while (b + 1 < numBlocks() && countBefore(b + 1) < static_cast<uint64_t>(t))
+                ++b;
+            hints.push_back(static_cast<uint32_t>(b));
         }
+        hints.push_back(static_cast<uint32_t>(numBlocks() - 1));
+    }
 
-        const int numBigBlocks = (n_ + bigBlockSize_ - 1) / bigBlockSize_;
-        bigBlockRanks_.assign(static_cast<size_t>(numBigBlocks), 0);
+    void buildSelectHints()
+    {
+        buildHints(select1Store_, totalOnes_, [this](size_t b)
+                   { return onesBeforeBlock(b); });
+        buildHints(select0Store_, n_ - totalOnes_, [this](size_t b)
+                   { return zerosBeforeBlock(b); });
+        select1Hints_ = select1Store_;
+        select0Hints_ = select0Store_;
+    }
 
-        const int numSmallBlocks = (n_ + smallBlockSize_ - 1) / smallBlockSize_;
-        smallBlockRanks_.assign(static_cast<size_t>(numSmallBlocks), 0);
+    // (u64 count, elements, zero padding to 8 bytes)
+    template <class T>
+    static size_t arrayBytes(std::span<const T> v)
+    {
+        return sizeof(uint64_t) + ((v.size() * sizeof(T) + 7) & ~size_t{7});
+    }
 
-        int rank = 0;
-        for (int big = 0; big < numBigBlocks; ++big)
+    static void put_u64(std::vector<uint8_t> &out, size_t &pos, uint64_t v)
+    {
+        std::memcpy(out.data() + pos, &v, sizeof(v));
+        pos += sizeof(v);
+    }
+
+    // out is zero-filled, so the padding is already in place.
+    template <class T>
+    static void put_array(std::vector<uint8_t> &out, size_t &pos, std::span<const T> v)
+    {
+        put_u64(out, pos, static_cast<uint64_t>(v.size()));
+        if (!v.empty())
+            std::memcpy(out.data() + pos, v.data(), v.size() * sizeof(T));
+        pos += (v.size() * sizeof(T) + 7) & ~size_t{7};
+    }
+
+    // Points view at the array in place, or copies it into store when asked
+    // to (or when the bytes are not aligned for T).
+    template <class T>
+    static bool read_array(std::span<const uint8_t> in, size_t &pos, bool copy,
+                           std::span<const T> &view, std::vector<T> &store)
+    {
+        uint64_t count = 0;
+        if (in.size() - pos < sizeof(count))
+            return false;
+        std::memcpy(&count, in.data() + pos, sizeof(count));
+        pos += sizeof(count);
+        if (count > (in.size() - pos) / sizeof(T))
+            return false;
+
+        const size_t n = static_cast<size_t>(count);
+        const uint8_t *p = in.data() + pos;
+        if (copy || reinterpret_cast<uintptr_t>(p) % alignof(T) != 0)
+        {
+            store.resize(n);
+            if (n > 0)
+                std::memcpy(store.data(), p, n * sizeof(T));
+            view = store;
+        }
+        else
         {
-            const int bigStart = big * bigBlockSize_;
-            bigBlockRanks_[static_cast<size_t>(big)] = rank;
+            store.clear();
+            view = std::span<const T>(reinterpret_cast<const T *>(p), n);
+        }
+        pos = (pos + n * sizeof(T) + 7) & ~size_t{7};
+        return pos <= in.size();
+    }
 
-            for (int small = 0; small < numSmallBlocksPerBig_; ++small)
+    // words_ / n_ must already be set. Rejects anything that does not fit them.
+    bool parseIndex(std::span<const uint8_t> in, bool copy)
+    {
+        uint64_t nbits = 0;
+        uint64_t ones = 0;
+        if (in.size() < 16)
+            return false;
+        std::memcpy(&nbits, in.data(), sizeof(nbits));
+        std::memcpy(&ones, in.data() + 8, sizeof(ones));
+        if (nbits != static_cast<uint64_t>(n_) || ones > nbits)
+            return false;
+
+        size_t pos = 16;
+        if (!read_array(in, pos, copy, rankDir_, rankDirStore_) ||
+            !read_array(in, pos, copy, select1Hints_, select1Store_) ||
+            !read_array(in, pos, copy, select0Hints_, select0Store_))
+            return false;
+
+        totalOnes_ = static_cast<int>(ones);
+        nWords_ = (static_cast<size_t>(n_) + 63) / 64;
+        if (n_ <= 0)
+            return rankDir_.empty() && select1Hints_.empty() && select0Hints_.empty();
+
+        const size_t blocks = nWords_ / kWordsPerBlock + 1;
+        if (rankDir_.size() != 2 * blocks)
+            return false;
+        const size_t last = blocks - 1;
+        if (onesBeforeBlock(last) + subRank(last, nWords_ - last * kWordsPerBlock) != ones)
+            return false;
+
+        // Checked once here so that findBlock can trust them: in range,
+        // non-decreasing, ending at the last block, and each sample in the
+        // block the rank directory puts the (j * kSelectSample + 1)-th 1/0 in.
+        auto hintsOk = [&](std::span<const uint32_t> h, int total, auto countBefore)
+        {
+            if (h.empty())
+                return true;
+            const size_t expect = total <= 0 ? 0 : static_cast<size_t>((total - 1) >> kSelectSampleShift) + 2;
+            if (h.size() != expect || h.back() != last)
+                return false;
+            for (size_t j = 0; j + 1 < h.size(); ++j)
             {
-                const int globalSmall = big * numSmallBlocksPerBig_ + small;
-                if (globalSmall >= numSmallBlocks)
-                    break;
-
-                smallBlockRanks_[static_cast<size_t>(globalSmall)] =
-                    rank - bigBlockRanks_[static_cast<size_t>(big)];
-
-                const int smallStart = bigStart + small * smallBlockSize_;
-                for (int j = 0; j < smallBlockSize_; ++j)
-                {
-                    const int pos = smallStart + j;
-                    if (pos >= n_)
-                        break;
-                    if (bv_.get(static_cast<size_t>(pos)))
-                        rank++;
-                }
+                const size_t b = h[j];
+                if (b >= blocks || h[j + 1] < b)
+                    return false;
+                const uint64_t t = (static_cast<uint64_t>(j) << kSelectSampleShift) + 1;
+                if (countBefore(b) >= t || (b < last && countBefore(b + 1) < t))
+                    return false;
             }
-        }
-
-        totalOnes_ = rank;
+            return true;
+        };
+        return hintsOk(select1Hints_, totalOnes_, [this](size_t b)
+                       { return onesBeforeBlock(b); }) &&
+               hintsOk(select0Hints_, n_ - totalOnes_, [this](size_t b)
+                       { return zerosBeforeBlock(b); });
     }
 };
@@ -0,0 +1,163 @@
+#include "dawg/dawg_reader_utf16.hpp"
+
+#include <stdexcept>
+
+#include "common/label_ops_utf16.hpp"
+
+namespace
+{
+    PackedIntsView viewOf(const DawgUtf16::Packed &p)
+    {
+        return PackedIntsView(p.words, p.width, static_cast<size_t>(p.n));
+    }
+
+    // u64 width, u64 n, u64 wordCount, u64 words[] (DawgUtf16::writePacked)
+    PackedIntsView readPacked(MappedReader &in)
+    {
+        const uint64_t width = in.u64();
+        const uint64_t n = in.u64();
+        const uint64_t wordN = in.u64();
+        if (width > 32 || wordN != (n * width + 63) / 64 + 1)
+            in.fail("malformed packed array");
+        return PackedIntsView(in.array<uint64_t>(static_cast<size_t>(wordN)), static_cast<uint32_t>(width),
+                              static_cast<size_t>(n));
+    }
+} // namespace
+
+DawgReaderUtf16::DawgReaderUtf16(const DawgUtf16 &dawg)
+    : keyCount_(dawg.keyCount),
+      isFinal_(dawg.isFinal),
+      labels_(dawg.labels),
+      edgeBegin_(viewOf(dawg.edgeBegin)),
+      targets_(viewOf(dawg.targets)),
+      skips_(viewOf(dawg.skips)),
+      termIdByRank_(viewOf(dawg.termIdByRank))
+{
+    validate();
+}
+
+void DawgReaderUtf16::validate() const
+{
+    if (isFinal_.size() == 0 || edgeBegin_.size() != isFinal_.size() + 1 ||
+        targets_.size() != labels_.size() || skips_.size() != labels_.size() ||
+        termIdByRank_.size() != keyCount_ || edgeBegin_.get(isFinal_.size()) != labels_.size())
+        throw std::runtime_error("DawgReaderUtf16: empty or malformed DAWG");
+}
+
+DawgReaderUtf16 DawgReaderUtf16::mapFromFile(const std::string &path)
+{
+    DawgReaderUtf16 r;
+    r.map_ = MappedFile::open(path);
+
+    MappedReader in(r.map_->data(), r.map_->size(), "DawgReaderUtf16: " + path);
+    if (in.remaining() < sizeof(uint64_t) || in.u64() != DawgUtf16::kMagic)
+        in.fail("not a DAWG file");
+    r.keyCount_ = in.u64();
+    r.isFinal_ = in.bits();
+    const auto labels = in.array<char16_t>(static_cast<size_t>(in.u64()));
+    r.edgeBegin_ = readPacked(in);
+    r.targets_ = readPacked(in);
+    r.skips_ = readPacked(in);
+    r.termIdByRank_ = readPacked(in);
+
+    // The label array is padded to a multiple of 4; the edge count is targets' size.
+    if (r.targets_.size() > labels.size())
+        in.fail("label/edge count mismatch");
+    r.labels_ = labels.first(r.targets_.size());
+
+    r.validate();
+    return r;
+}
+
+DawgReaderUtf16 DawgReaderUtf16::loadFromFile(const std::string &path)
+{
+    // Heap-allocated so the views stay valid when the reader is moved.
+    auto dawg = std::make_shared<const DawgUtf16>(DawgUtf16::loadFromFile(path));
+    DawgReaderUtf16 r(*dawg);
+    r.owned_ = std::move(dawg);
+    return r;
+}
+
+int64_t DawgReaderUtf16::next(uint32_t s, char16_t c, uint32_t &rank) const
+{
+    const size_t first = edgeBegin_.get(s);
+    const size_t n = edgeBegin_.get(static_cast<size_t>(s) + 1) - first;
+    const int k = labelops::findSorted(labels_, first, n, c);
+    if (k < 0)
+        return -1;
+
+    const size_t e = first + static_cast<size_t>(k);
+    rank += skips_.get(e);
+    return targets_.get(e);
+}
+
+int32_t DawgReaderUtf16::getTermId(const std::u16string &key) const
+{
+    if (key.empty())
+        return -1;
+
+    uint32_t s = 0; // root
+    uint32_t rank = 0;
+    for (char16_t ch : key)
+    {
+        const int64_t t = next(s, ch, rank);
+        if (t < 0)
+            return -1;
+        s = static_cast<uint32_t>(t);
+    }
+    return isFinal_.get(s) ? static_cast<int32_t>(termIdByRank_.get(rank)) : -1;
+}
+
+std::pair<size_t, int32_t> DawgReaderUtf16::longestPrefixTermId(const std::u16string &key) const
+{
+    size_t bestLen = 0;
+    int32_t bestTermId = -1;
+
+    uint32_t s = 0;
+    uint32_t rank = 0;
+    for (size_t i = 0; i < key.size(); ++i)
+    {
+        const int64_t t = next(s, key[i], rank);
+        if (t < 0)
+            break;
+        s = static_cast<uint32_t>(t);
+
+        if (isFinal_.get(s))
+        {
+            bestLen = i + 1;
+            bestTermId = static_cast<int32_t>(termIdByRank_.get(rank));
+        }
+    }
+    return {bestLen, bestTermId};
+}
+
+size_t DawgReaderUtf16::commonPrefixSearch(std::u16string_view key, std::vector<PrefixHit> &out) const
+{
+    out.clear();
+
+    uint32_t s = 0;
+    uint32_t rank = 0;
+    for (size_t i = 0; i < key.size(); ++i)
+    {
+        const int64_t t = next(s, key[i], rank);
+        if (t < 0)
+            break;
+        s = static_cast<uint32_t>(t);
+
+        if (isFinal_.get(s))
+            out.push_back(PrefixHit{static_cast<uint32_t>(i + 1), static_cast<int32_t>(termIdByRank_.get(rank))});
+    }
+    return out.size();
+}
+
+std::vector<std::u16string> DawgReaderUtf16::commonPrefixSearch(const std::u16string &str) const
+{
+    std::vector<PrefixHit> hits;
+    commonPrefixSearch(str, hits);
+
+    std::vector<std::u16string> result;
+    result.reserve(hits.size());
+    for (const auto &hit : hits)
+        result.emplace_back(str, 0, hit.length);
+    return result;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common/bit_vector_utf16.hpp"
+#include "common/mapped_file_utf16.hpp"
+#include "common/packed_ints_utf16.hpp"
+#include "common/prefix_hit_utf16.hpp"
+#include "dawg_utf16.hpp"
+
+// Reader for DawgUtf16 (.dawg), with the same lookups as
+// LOUDSWithTermIdReaderUtf16: fused common-prefix search, exact termId lookup
+// and longest prefix.
+//
+// A step reads the state's edge range from edgeBegin, searches the sorted
+// labels, and adds the edge's skip to the running rank. A terminal state yields
+// termIdByRank[rank].
+//
+// Like the other readers it works on views: into a DawgUtf16 that must outlive
+// it, into a copy it owns (loadFromFile), or into a file mapped by mapFromFile
+// (which keeps the mapping alive).
+class DawgReaderUtf16
+{
+public:
+    using PrefixHit = PrefixHitUtf16;
+
+    explicit DawgReaderUtf16(const DawgUtf16 &dawg);
+
+    static DawgReaderUtf16 mapFromFile(const std::string &path);
+    static DawgReaderUtf16 loadFromFile(const std::string &path);
+
+    int32_t getTermId(const std::u16string &key) const;
+    std::pair<size_t, int32_t> longestPrefixTermId(const std::u16string &key) const;
+
+    // Same contract as LOUDSWithTermIdReaderUtf16::commonPrefixSearch.
+    size_t commonPrefixSearch(std::u16string_view key, std::vector<PrefixHit> &out) const;
+    std::vector<std::u16string> commonPrefixSearch(const std::u16string &str) const;
+
+    size_t keyCount() const { return static_cast<size_t>(keyCount_); }
+    size_t stateCount() const { return isFinal_.size(); }
+    size_t edgeCount() const { return labels_.size(); }
+
+    // Bytes lookups touch (labels, packed arrays and the final bits).
+    size_t memoryBytes() const
+    {
+        return labels_.size() * sizeof(char16_t) + edgeBegin_.bytes() + targets_.bytes() + skips_.bytes() +
+               termIdByRank_.bytes() + isFinal_.numWords() * sizeof(uint64_t);
+    }
+
+private:
+    DawgReaderUtf16() = default;
+
+    void validate() const;
+
+    // Follows the edge of state s labelled c, adding its skip to rank; -1 if none.
+    int64_t next(uint32_t s, char16_t c, uint32_t &rank) const;
+
+    std::shared_ptr<const MappedFile> map_;  // null unless mapFromFile
+    std::shared_ptr<const DawgUtf16> owned_; // null unless loadFromFile
+
+    uint64_t keyCount_{0};
+    BitVectorView isFinal_;
+    std::span<const char16_t> labels_;
+    PackedIntsView edgeBegin_;
+    PackedIntsView targets_;
+    PackedIntsView skips_;
+    PackedIntsView termIdByRank_;
+};
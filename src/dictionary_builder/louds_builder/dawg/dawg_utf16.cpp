@@ -0,0 +1,323 @@
+#include "dawg/dawg_utf16.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "common/packed_ints_utf16.hpp"
+
+namespace
+{
+    // Daciuk et al.'s incremental construction from sorted keys: the path of
+    // the previous key stays unminimized; once the next key leaves it, the
+    // states below the branch point are replaced by an equal registered state
+    // or registered themselves, bottom-up.
+    class Minimizer
+    {
+    public:
+        struct State
+        {
+            std::vector<std::pair<char16_t, uint32_t>> edges; // sorted by label (keys arrive sorted)
+            bool final = false;
+        };
+
+        Minimizer() { states_.emplace_back(); }
+
+        void add(const std::u16string &key)
+        {
+            size_t common = 0;
+            while (common < key.size() && common < prev_.size() && key[common] == prev_[common])
+                ++common;
+            minimize(common);
+
+            uint32_t s = path_.empty() ? 0 : path_.back().child;
+            for (size_t i = common; i < key.size(); ++i)
+            {
+                const uint32_t t = static_cast<uint32_t>(states_.size());
+                states_.emplace_back();
+                states_[s].edges.emplace_back(key[i], t);
+                path_.push_back(Step{s, t});
+                s = t;
+            }
+            states_[s].final = true;
+            prev_ = key;
+        }
+
+        std::vector<State> finish()
+        {
+            minimize(0);
+            return std::move(states_);
+        }
+
+    private:
+        struct Step
+        {
+            uint32_t parent;
+            uint32_t child; // target of parent's last edge
+        };
+
+        std::vector<State> states_;
+        std::vector<Step> path_; // path_[i] is the edge for prev_[i]
+        std::u16string prev_;
+        std::unordered_map<std::u16string, uint32_t> register_;
+
+        static std::u16string signature(const State &s)
+        {
+            std::u16string sig;
+            sig.reserve(1 + 3 * s.edges.size());
+            sig.push_back(s.final ? u'1' : u'0');
+            for (const auto &[c, t] : s.edges)
+            {
+                sig.push_back(c);
+                sig.push_back(static_cast<char16_t>(t >> 16));
+                sig.push_back(static_cast<char16_t>(t & 0xFFFF));
+            }
+            return sig;
+        }
+
+        void minimize(size_t downTo)
+        {
+            while (path_.size() > downTo)
+            {
+                const Step step = path_.back();
+                path_.pop_back();
+
+                auto sig = signature(states_[step.child]);
+                const auto it = register_.find(sig);
+                if (it != register_.end())
+                {
+                    states_[step.parent].edges.back().second = it->second;
+                    states_[step.child] = State{}; // unreachable from now on
+                }
+                else
+                {
+                    register_.emplace(std::move(sig), step.child);
+                }
+            }
+        }
+    };
+} // namespace
+
+DawgUtf16 DawgUtf16::build(const std::vector<std::u16string> &keys,
+                           const std::vector<int32_t> &termIds)
+{
+    if (keys.size() != termIds.size())
+        throw std::runtime_error("DawgUtf16::build: keys/termIds size mismatch");
+
+    // Ranks are positions in this order, which is also the order the minimizer needs.
+    std::vector<std::pair<std::u16string, int32_t>> sorted;
+    sorted.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (keys[i].empty())
+            continue;
+        if (termIds[i] < 0)
+            throw std::runtime_error("DawgUtf16::build: negative termId");
+        sorted.emplace_back(keys[i], termIds[i]);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b)
+                     { return a.first < b.first; });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), [](const auto &a, const auto &b)
+                             { return a.first == b.first; }),
+                 sorted.end());
+
+    Minimizer m;
+    for (const auto &kv : sorted)
+        m.add(kv.first);
+    const std::vector<Minimizer::State> states = m.finish();
+
+    // Renumber the reachable states in reverse post-order (a topological
+    // order: root first, every edge pointing forward).
+    std::vector<bool> seen(states.size(), false);
+    std::vector<uint32_t> post;
+    {
+        std::vector<std::pair<uint32_t, size_t>> stack{{0u, 0}};
+        seen[0] = true;
+        while (!stack.empty())
+        {
+            auto &[s, next] = stack.back();
+            if (next < states[s].edges.size())
+            {
+                const uint32_t t = states[s].edges[next++].second;
+                if (!seen[t])
+                {
+                    seen[t] = true;
+                    stack.emplace_back(t, 0);
+                }
+                continue;
+            }
+            post.push_back(s);
+            stack.pop_back();
+        }
+    }
+    const size_t stateN = post.size();
+    std::vector<uint32_t> newId(states.size(), UINT32_MAX);
+    for (size_t i = 0; i < stateN; ++i)
+        newId[post[stateN - 1 - i]] = static_cast<uint32_t>(i);
+
+    // Keys below each state, from the leaves up.
+    std::vector<uint32_t> below(stateN, 0);
+    for (size_t i = stateN; i-- > 0;)
+    {
+        const auto &st = states[post[stateN - 1 - i]];
+        uint64_t n = st.final ? 1 : 0;
+        for (const auto &e : st.edges)
+            n += below[newId[e.second]];
+        below[i] = static_cast<uint32_t>(n);
+    }
+
+    DawgUtf16 d;
+    d.keyCount = sorted.size();
+
+    std::vector<uint32_t> edgeBegin;
+    std::vector<uint32_t> targets;
+    std::vector<uint32_t> skips;
+    edgeBegin.reserve(stateN + 1);
+    for (size_t i = 0; i < stateN; ++i)
+    {
+        const auto &st = states[post[stateN - 1 - i]];
+        d.isFinal.push_back(st.final);
+        edgeBegin.push_back(static_cast<uint32_t>(targets.size()));
+
+        uint32_t skip = st.final ? 1 : 0;
+        for (const auto &[c, t] : st.edges)
+        {
+            d.labels.push_back(c);
+            targets.push_back(newId[t]);
+            skips.push_back(skip);
+            skip += below[newId[t]];
+        }
+    }
+    edgeBegin.push_back(static_cast<uint32_t>(targets.size()));
+
+    std::vector<uint32_t> byRank;
+    byRank.reserve(sorted.size());
+    for (const auto &kv : sorted)
+        byRank.push_back(static_cast<uint32_t>(kv.second));
+
+    d.edgeBegin = pack(edgeBegin);
+    d.targets = pack(targets);
+    d.skips = pack(skips);
+    d.termIdByRank = pack(byRank);
+    return d;
+}
+
+DawgUtf16::Packed DawgUtf16::pack(const std::vector<uint32_t> &values)
+{
+    Packed p;
+    p.width = packedints::widthFor(values.empty() ? 0 : *std::max_element(values.begin(), values.end()));
+    p.n = values.size();
+    p.words = packedints::pack(values, p.width);
+    return p;
+}
+
+void DawgUtf16::write_u64(std::ostream &os, uint64_t v)
+{
+    os.write(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+void DawgUtf16::read_u64(std::istream &is, uint64_t &v)
+{
+    is.read(reinterpret_cast<char *>(&v), sizeof(v));
+}
+
+void DawgUtf16::writePacked(std::ostream &os, const Packed &p)
+{
+    write_u64(os, p.width);
+    write_u64(os, p.n);
+    write_u64(os, static_cast<uint64_t>(p.words.size()));
+    os.write(reinterpret_cast<const char *>(p.words.data()),
+             static_cast<std::streamsize>(p.words.size() * sizeof(uint64_t)));
+}
+
+DawgUtf16::Packed DawgUtf16::readPacked(std::istream &is)
+{
+    Packed p;
+    uint64_t width = 0;
+    uint64_t wordN = 0;
+    read_u64(is, width);
+    read_u64(is, p.n);
+    read_u64(is, wordN);
+    if (!is || width > 32 || wordN != (p.n * width + 63) / 64 + 1)
+        throw std::runtime_error("DawgUtf16: malformed packed array");
+    p.width = static_cast<uint32_t>(width);
+    p.words.resize(static_cast<size_t>(wordN));
+    is.read(reinterpret_cast<char *>(p.words.data()), static_cast<std::streamsize>(wordN * sizeof(uint64_t)));
+    return p;
+}
+
+void DawgUtf16::saveToFile(const std::string &path) const
+{
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs)
+        throw std::runtime_error("failed to open file for write: " + path);
+
+    write_u64(ofs, kMagic);
+    write_u64(ofs, keyCount);
+
+    write_u64(ofs, static_cast<uint64_t>(isFinal.size()));
+    write_u64(ofs, static_cast<uint64_t>(isFinal.words().size()));
+    ofs.write(reinterpret_cast<const char *>(isFinal.words().data()),
+              static_cast<std::streamsize>(isFinal.words().size() * sizeof(uint64_t)));
+
+    // Pad the labels so the packed arrays start 8-byte aligned.
+    const size_t paddedN = (labels.size() + 3) & ~size_t{3};
+    write_u64(ofs, static_cast<uint64_t>(paddedN));
+    ofs.write(reinterpret_cast<const char *>(labels.data()),
+              static_cast<std::streamsize>(labels.size() * sizeof(char16_t)));
+    const char16_t pad = u' ';
+    for (size_t i = labels.size(); i < paddedN; ++i)
+        ofs.write(reinterpret_cast<const char *>(&pad), sizeof(pad));
+
+    writePacked(ofs, edgeBegin);
+    writePacked(ofs, targets);
+    writePacked(ofs, skips);
+    writePacked(ofs, termIdByRank);
+
+    if (!ofs)
+        throw std::runtime_error("failed to write file: " + path);
+}
+
+DawgUtf16 DawgUtf16::loadFromFile(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("failed to open file for read: " + path);
+
+    uint64_t magic = 0;
+    read_u64(ifs, magic);
+    if (!ifs || magic != kMagic)
+        throw std::runtime_error("not a DAWG file: " + path);
+
+    DawgUtf16 d;
+    read_u64(ifs, d.keyCount);
+
+    uint64_t nbits = 0;
+    uint64_t nwords = 0;
+    read_u64(ifs, nbits);
+    read_u64(ifs, nwords);
+    if (!ifs || nwords != (nbits + 63) / 64)
+        throw std::runtime_error("failed to read file: " + path);
+    std::vector<uint64_t> words(static_cast<size_t>(nwords));
+    ifs.read(reinterpret_cast<char *>(words.data()), static_cast<std::streamsize>(nwords * sizeof(uint64_t)));
+    d.isFinal.assign_from_words(static_cast<size_t>(nbits), std::move(words));
+
+    uint64_t labelN = 0;
+    read_u64(ifs, labelN);
+    d.labels.resize(static_cast<size_t>(labelN));
+    ifs.read(reinterpret_cast<char *>(d.labels.data()), static_cast<std::streamsize>(labelN * sizeof(char16_t)));
+
+    d.edgeBegin = readPacked(ifs);
+    d.targets = readPacked(ifs);
+    d.skips = readPacked(ifs);
+    d.termIdByRank = readPacked(ifs);
+    if (!ifs || d.edgeBegin.n != d.isFinal.size() + 1 || d.targets.n != d.skips.n ||
+        d.targets.n > d.labels.size() || d.termIdByRank.n != d.keyCount)
+        throw std::runtime_error("failed to read file: " + path);
+
+    // Drop the label padding so labels.size() is the edge count again.
+    d.labels.resize(static_cast<size_t>(d.targets.n));
+    return d;
+}
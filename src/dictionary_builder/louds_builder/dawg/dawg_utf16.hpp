@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common/bit_vector_utf16.hpp"
+
+// Minimized acyclic automaton (DAWG) over the yomi keys (UTF-16), with termIds
+// recovered by path-count numbering.
+//
+// The trie shares prefixes only; the DAWG also merges states whose sets of
+// continuations are equal, so common endings (conjugation tails, する, ...)
+// are stored once. A state no longer identifies a key, so termIds cannot hang
+// off states. Instead each key's rank among the keys in std::u16string order
+// (a prefix before its extensions) is the sum of the skip values on its path,
+// and termIdByRank maps that rank to the termId.
+//
+// - state 0 is the root; every edge goes to a higher-numbered state.
+// - the edges of state s are [edgeBegin[s], edgeBegin[s + 1]), sorted by label.
+// - isFinal[s] == 1 iff a key ends at s.
+// - skips[e] for edge e of state s: isFinal[s] plus the number of keys below
+//   the edges of s before e, i.e. the keys that sort before the ones through e.
+//
+// The integer arrays are fixed-width packed (common/packed_ints_utf16.hpp),
+// each as narrow as its largest value allows.
+//
+// File layout (.dawg), everything 8-byte aligned for DawgReaderUtf16::mapFromFile:
+//   u64 kMagic
+//   u64 keyCount
+//   isFinal (BitVector: u64 nbits, u64 wordCount, u64 words[])
+//   u64 labelN, u16 labels[labelN]   (padded to a multiple of 4)
+//   edgeBegin, targets, skips, termIdByRank (packed: u64 width, u64 n, u64 wordCount, u64 words[])
+class DawgUtf16
+{
+public:
+    static constexpr uint64_t kMagic = 0x3147574144554B4BULL; // "KKUDAWG1"
+
+    // Packed integers as stored (see packedints::pack).
+    struct Packed
+    {
+        uint32_t width = 0;
+        uint64_t n = 0;
+        std::vector<uint64_t> words;
+    };
+
+    uint64_t keyCount = 0;
+    BitVector isFinal;
+    std::vector<char16_t> labels;
+    Packed edgeBegin;
+    Packed targets;
+    Packed skips;
+    Packed termIdByRank;
+
+    // keys need not be sorted. Empty keys are skipped; for duplicate keys the
+    // first termId wins. termIds must be non-negative.
+    static DawgUtf16 build(const std::vector<std::u16string> &keys,
+                           const std::vector<int32_t> &termIds);
+
+    size_t stateCount() const { return isFinal.size(); }
+    size_t edgeCount() const { return labels.size(); }
+
+    void saveToFile(const std::string &path) const;
+    static DawgUtf16 loadFromFile(const std::string &path);
+
+private:
+    static void write_u64(std::ostream &os, uint64_t v);
+    static void read_u64(std::istream &is, uint64_t &v);
+
+    static Packed pack(const std::vector<uint32_t> &values);
+    static void writePacked(std::ostream &os, const Packed &p);
+    static Packed readPacked(std::istream &is);
+};
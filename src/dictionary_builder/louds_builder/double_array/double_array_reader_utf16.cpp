@@ -0,0 +1,113 @@
+#include "double_array/double_array_reader_utf16.hpp"
+
+#include <stdexcept>
+
+DoubleArrayReaderUtf16::DoubleArrayReaderUtf16(const DoubleArrayUtf16 &da)
+    : codes_(da.codes),
+      units_(da.units),
+      keyCount_(da.keyCount)
+{
+    if (codes_.size() != DoubleArrayUtf16::kCodeN || units_.empty())
+        throw std::runtime_error("DoubleArrayReaderUtf16: empty or malformed double array");
+}
+
+DoubleArrayReaderUtf16 DoubleArrayReaderUtf16::mapFromFile(const std::string &path)
+{
+    DoubleArrayReaderUtf16 r;
+    r.map_ = MappedFile::open(path);
+
+    MappedReader in(r.map_->data(), r.map_->size(), "DoubleArrayReaderUtf16: " + path);
+    if (in.remaining() < sizeof(uint64_t) || in.u64() != DoubleArrayUtf16::kMagic)
+        in.fail("not a double-array file");
+    r.keyCount_ = in.u64();
+
+    const uint64_t codeN = in.u64();
+    if (codeN != DoubleArrayUtf16::kCodeN)
+        in.fail("code table size mismatch");
+    r.codes_ = in.array<uint16_t>(static_cast<size_t>(codeN));
+
+    const uint64_t unitN = in.u64();
+    r.units_ = in.array<DoubleArrayUtf16::Unit>(static_cast<size_t>(unitN));
+    if (r.units_.empty())
+        in.fail("empty double array");
+    return r;
+}
+
+DoubleArrayReaderUtf16 DoubleArrayReaderUtf16::loadFromFile(const std::string &path)
+{
+    // Heap-allocated so the views stay valid when the reader is moved.
+    auto da = std::make_shared<const DoubleArrayUtf16>(DoubleArrayUtf16::loadFromFile(path));
+    DoubleArrayReaderUtf16 r(*da);
+    r.owned_ = std::move(da);
+    return r;
+}
+
+int32_t DoubleArrayReaderUtf16::getTermId(const std::u16string &key) const
+{
+    int32_t s = 0; // root
+    for (char16_t ch : key)
+    {
+        s = next(s, ch);
+        if (s < 0)
+            return -1;
+    }
+
+    const int32_t t = terminal(s);
+    return t < 0 ? -1 : units_[static_cast<size_t>(t)].base;
+}
+
+std::pair<size_t, int32_t> DoubleArrayReaderUtf16::longestPrefixTermId(const std::u16string &key) const
+{
+    int32_t s = 0;
+
+    size_t bestLen = 0;
+    int32_t bestTermId = -1;
+
+    for (size_t i = 0; i < key.size(); ++i)
+    {
+        s = next(s, key[i]);
+        if (s < 0)
+            break;
+
+        const int32_t t = terminal(s);
+        if (t >= 0 && units_[static_cast<size_t>(t)].base >= 0)
+        {
+            bestLen = i + 1;
+            bestTermId = units_[static_cast<size_t>(t)].base;
+        }
+    }
+
+    return {bestLen, bestTermId};
+}
+
+size_t DoubleArrayReaderUtf16::commonPrefixSearch(std::u16string_view key, std::vector<PrefixHit> &out) const
+{
+    out.clear();
+
+    int32_t s = 0;
+    for (size_t i = 0; i < key.size(); ++i)
+    {
+        s = next(s, key[i]);
+        if (s < 0)
+            break;
+
+        const int32_t t = terminal(s);
+        if (t < 0)
+            continue;
+
+        out.push_back(PrefixHit{static_cast<uint32_t>(i + 1), units_[static_cast<size_t>(t)].base});
+    }
+    return out.size();
+}
+
+std::vector<std::u16string> DoubleArrayReaderUtf16::commonPrefixSearch(const std::u16string &str) const
+{
+    std::vector<PrefixHit> hits;
+    commonPrefixSearch(str, hits);
+
+    std::vector<std::u16string> result;
+    result.reserve(hits.size());
+    for (const auto &hit : hits)
+        result.emplace_back(str, 0, hit.length);
+    return result;
+}
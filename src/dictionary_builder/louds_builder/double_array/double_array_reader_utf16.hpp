@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common/mapped_file_utf16.hpp"
+#include "common/prefix_hit_utf16.hpp"
+#include "double_array_utf16.hpp"
+
+// Reader for DoubleArrayUtf16 (.da), with the same lookups as
+// LOUDSWithTermIdReaderUtf16: fused common-prefix search, exact termId lookup
+// and longest prefix. Each step is codes[c], one add and one check compare.
+//
+// Like LOUDSWithTermIdReaderUtf16 it works on views: into a DoubleArrayUtf16 that
+// must outlive it, into a copy it owns (loadFromFile), or into a file mapped by
+// mapFromFile (which keeps the mapping alive).
+class DoubleArrayReaderUtf16
+{
+public:
+    using PrefixHit = PrefixHitUtf16;
+
+    explicit DoubleArrayReaderUtf16(const DoubleArrayUtf16 &da);
+
+    // Zero-copy reader over a .da file.
+    static DoubleArrayReaderUtf16 mapFromFile(const std::string &path);
+
+    // Reads the file into memory owned by the returned reader.
+    static DoubleArrayReaderUtf16 loadFromFile(const std::string &path);
+
+    int32_t getTermId(const std::u16string &key) const;
+    std::pair<size_t, int32_t> longestPrefixTermId(const std::u16string &key) const;
+
+    // Same contract as LOUDSWithTermIdReaderUtf16::commonPrefixSearch: out is
+    // cleared, then gets one PrefixHit per terminal node on key's path, shortest first.
+    size_t commonPrefixSearch(std::u16string_view key, std::vector<PrefixHit> &out) const;
+
+    // Matched prefixes, shortest first.
+    std::vector<std::u16string> commonPrefixSearch(const std::u16string &str) const;
+
+    size_t keyCount() const { return static_cast<size_t>(keyCount_); }
+
+    // Bytes of the code table and units (what lookups touch).
+    size_t memoryBytes() const
+    {
+        return codes_.size() * sizeof(uint16_t) + units_.size() * sizeof(DoubleArrayUtf16::Unit);
+    }
+
+private:
+    DoubleArrayReaderUtf16() = default;
+
+    // Child of unit s by c, or -1.
+    int32_t next(int32_t s, char16_t c) const
+    {
+        const uint16_t code = codes_[static_cast<size_t>(c)];
+        if (code == 0)
+            return -1;
+        const int64_t t = static_cast<int64_t>(units_[static_cast<size_t>(s)].base) + code;
+        if (t >= static_cast<int64_t>(units_.size()) || units_[static_cast<size_t>(t)].check != s)
+            return -1;
+        return static_cast<int32_t>(t);
+    }
+
+    // Terminal unit of s (its code-0 child), or -1 if no key ends at s.
+    int32_t terminal(int32_t s) const
+    {
+        const int32_t t = units_[static_cast<size_t>(s)].base;
+        if (t < 0 || static_cast<size_t>(t) >= units_.size() || units_[static_cast<size_t>(t)].check != s)
+            return -1;
+        return t;
+    }
+
+    std::shared_ptr<const MappedFile> map_;          // null unless mapFromFile
+    std::shared_ptr<const DoubleArrayUtf16> owned_; // null unless loadFromFile
+
+    std::span<const uint16_t> codes_;
+    std::span<const DoubleArrayUtf16::Unit> units_;
+    uint64_t keyCount_{0};
+};
@@ -0,0 +1,256 @@
+#include "double_array/double_array_utf16.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    // Places nodes depth-first. Free units form a doubly linked list in
+    // position order, and findBase() takes the first free unit that fits every
+    // child code.
+    class Builder
+    {
+    public:
+        Builder(const std::vector<uint16_t> &codes,
+                const std::vector<std::pair<std::vector<uint16_t>, int32_t>> &keys)
+            : codes_(codes), keys_(keys)
+        {
+            grow(1);
+            take(0); // root
+        }
+
+        std::vector<DoubleArrayUtf16::Unit> run()
+        {
+            if (!keys_.empty())
+                buildNode(0, keys_.size(), 0, 0);
+
+            // Drop the free tail.
+            size_t n = units_.size();
+            while (n > 1 && units_[n - 1].check < 0)
+                --n;
+            units_.resize(n);
+            return std::move(units_);
+        }
+
+    private:
+        struct Child
+        {
+            uint16_t code;
+            size_t begin;
+            size_t end;
+        };
+
+        const std::vector<uint16_t> &codes_;
+        const std::vector<std::pair<std::vector<uint16_t>, int32_t>> &keys_;
+
+        std::vector<DoubleArrayUtf16::Unit> units_;
+        std::vector<int32_t> next_; // free list, -1 terminated
+        std::vector<int32_t> prev_;
+        int32_t head_{-1};
+        int32_t tail_{-1};
+
+        bool isFree(size_t t) const { return t >= units_.size() || (units_[t].check < 0 && t != 0); }
+
+        void grow(size_t n)
+        {
+            const size_t old = units_.size();
+            if (n <= old)
+                return;
+            units_.resize(n, DoubleArrayUtf16::Unit{0, -1});
+            next_.resize(n, -1);
+            prev_.resize(n, -1);
+            for (size_t i = old; i < n; ++i)
+            {
+                const int32_t t = static_cast<int32_t>(i);
+                prev_[i] = tail_;
+                if (tail_ >= 0)
+                    next_[static_cast<size_t>(tail_)] = t;
+                else
+                    head_ = t;
+                tail_ = t;
+            }
+        }
+
+        void take(size_t t)
+        {
+            if (t >= units_.size())
+                grow(std::max(t + 1, units_.size() * 2));
+            const int32_t p = prev_[t];
+            const int32_t n = next_[t];
+            if (p >= 0)
+                next_[static_cast<size_t>(p)] = n;
+            else
+                head_ = n;
+            if (n >= 0)
+                prev_[static_cast<size_t>(n)] = p;
+            else
+                tail_ = p;
+            next_[t] = prev_[t] = -1;
+        }
+
+        int32_t findBase(const std::vector<Child> &children) const
+        {
+            const int32_t c0 = children.front().code;
+            for (int32_t p = head_; p >= 0; p = next_[static_cast<size_t>(p)])
+            {
+                const int32_t b = p - c0;
+                if (b < 1)
+                    continue;
+                bool fits = true;
+                for (size_t k = 1; k < children.size() && fits; ++k)
+                    fits = isFree(static_cast<size_t>(b + children[k].code));
+                if (fits)
+                    return b;
+            }
+            return std::max<int32_t>(static_cast<int32_t>(units_.size()) - c0, 1);
+        }
+
+        // keys_[begin, end) share their first depth codes and lead to unit s.
+        void buildNode(size_t begin, size_t end, size_t depth, int32_t s)
+        {
+            std::vector<Child> children;
+            for (size_t i = begin; i < end; ++i)
+            {
+                const auto &key = keys_[i].first;
+                const uint16_t c = depth < key.size() ? key[depth] : 0;
+                if (children.empty() || children.back().code != c)
+                    children.push_back(Child{c, i, i + 1});
+                else
+                    children.back().end = i + 1;
+            }
+
+            const int32_t b = findBase(children);
+            units_[static_cast<size_t>(s)].base = b;
+            for (const auto &ch : children)
+            {
+                const size_t t = static_cast<size_t>(b + ch.code);
+                take(t);
+                units_[t].check = s;
+            }
+
+            for (const auto &ch : children)
+            {
+                const int32_t t = b + ch.code;
+                if (ch.code == 0)
+                    units_[static_cast<size_t>(t)].base = keys_[ch.begin].second;
+                else
+                    buildNode(ch.begin, ch.end, depth + 1, t);
+            }
+        }
+    };
+} // namespace
+
+DoubleArrayUtf16 DoubleArrayUtf16::build(const std::vector<std::u16string> &keys,
+                                         const std::vector<int32_t> &termIds)
+{
+    if (keys.size() != termIds.size())
+        throw std::runtime_error("DoubleArrayUtf16::build: keys/termIds size mismatch");
+
+    DoubleArrayUtf16 da;
+
+    // Label codes by descending frequency, so the busiest labels pack densely.
+    std::vector<uint64_t> freq(kCodeN, 0);
+    for (const auto &key : keys)
+        for (char16_t ch : key)
+            ++freq[static_cast<size_t>(ch)];
+
+    std::vector<uint32_t> order(kCodeN);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                     { return freq[a] > freq[b]; });
+
+    da.codes.assign(kCodeN, 0);
+    for (size_t i = 0; i < order.size() && freq[order[i]] > 0; ++i)
+        da.codes[order[i]] = static_cast<uint16_t>(i + 1);
+
+    // Keys as code sequences, sorted so that every node's keys are contiguous
+    // and a key that ends at a node (code 0) comes first.
+    std::vector<std::pair<std::vector<uint16_t>, int32_t>> coded;
+    coded.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (keys[i].empty())
+            continue;
+        std::vector<uint16_t> c;
+        c.reserve(keys[i].size());
+        for (char16_t ch : keys[i])
+            c.push_back(da.codes[static_cast<size_t>(ch)]);
+        coded.emplace_back(std::move(c), termIds[i]);
+    }
+    std::stable_sort(coded.begin(), coded.end(), [](const auto &a, const auto &b)
+                     { return a.first < b.first; });
+    coded.erase(std::unique(coded.begin(), coded.end(), [](const auto &a, const auto &b)
+                            { return a.first == b.first; }),
+                coded.end());
+
+    da.keyCount = coded.size();
+    da.units = Builder(da.codes, coded).run();
+    return da;
+}
+
+void DoubleArrayUtf16::write_u64(std::ostream &os, uint64_t v)
+{
+    os.write(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+void DoubleArrayUtf16::read_u64(std::istream &is, uint64_t &v)
+{
+    is.read(reinterpret_cast<char *>(&v), sizeof(v));
+}
+
+void DoubleArrayUtf16::saveToFile(const std::string &path) const
+{
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs)
+        throw std::runtime_error("failed to open file for write: " + path);
+
+    write_u64(ofs, kMagic);
+    write_u64(ofs, keyCount);
+
+    write_u64(ofs, static_cast<uint64_t>(codes.size()));
+    ofs.write(reinterpret_cast<const char *>(codes.data()),
+              static_cast<std::streamsize>(codes.size() * sizeof(uint16_t)));
+
+    write_u64(ofs, static_cast<uint64_t>(units.size()));
+    ofs.write(reinterpret_cast<const char *>(units.data()),
+              static_cast<std::streamsize>(units.size() * sizeof(Unit)));
+
+    if (!ofs)
+        throw std::runtime_error("failed to write file: " + path);
+}
+
+DoubleArrayUtf16 DoubleArrayUtf16::loadFromFile(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("failed to open file for read: " + path);
+
+    uint64_t magic = 0;
+    read_u64(ifs, magic);
+    if (!ifs || magic != kMagic)
+        throw std::runtime_error("not a double-array file: " + path);
+
+    DoubleArrayUtf16 da;
+    read_u64(ifs, da.keyCount);
+
+    uint64_t codeN = 0;
+    read_u64(ifs, codeN);
+    if (codeN != kCodeN)
+        throw std::runtime_error("double-array code table size mismatch: " + path);
+    da.codes.resize(static_cast<size_t>(codeN));
+    ifs.read(reinterpret_cast<char *>(da.codes.data()),
+             static_cast<std::streamsize>(codeN * sizeof(uint16_t)));
+
+    uint64_t unitN = 0;
+    read_u64(ifs, unitN);
+    da.units.resize(static_cast<size_t>(unitN));
+    ifs.read(reinterpret_cast<char *>(da.units.data()),
+             static_cast<std::streamsize>(unitN * sizeof(Unit)));
+
+    if (!ifs)
+        throw std::runtime_error("failed to read file: " + path);
+    return da;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Double-array trie (UTF-16 keys) with a termId per key.
+//
+// An alternative to LOUDSWithTermIdUtf16 for the yomi trie: a transition is one
+// add and one compare instead of rank/select, at the cost of more memory.
+//
+// - codes maps each UTF-16 code unit to a label code (1.., most frequent first;
+//   0 = the code unit appears in no key).
+// - units[s] is node s (root = 0). The child of s by code c is t = base(s) + c,
+//   valid iff units[t].check == s.
+// - A key ends at s iff the child by code 0 exists; that terminal unit keeps the
+//   termId in its base and has no children.
+// - Free units have check == -1 (as does the root).
+//
+// File layout (.da), everything 8-byte aligned for DoubleArrayReaderUtf16::mapFromFile:
+//   u64 kMagic
+//   u64 keyCount
+//   u64 codeN (= 65536), u16 codes[codeN]
+//   u64 unitN, Unit units[unitN]
+class DoubleArrayUtf16
+{
+public:
+    static constexpr uint64_t kMagic = 0x315941525241444BULL; // "KDARRAY1"
+    static constexpr size_t kCodeN = 0x10000;
+
+    struct Unit
+    {
+        int32_t base;
+        int32_t check;
+    };
+
+    std::vector<uint16_t> codes;
+    std::vector<Unit> units;
+    uint64_t keyCount = 0;
+
+    // keys need not be sorted. Empty keys are skipped; for duplicate keys the
+    // first termId wins.
+    static DoubleArrayUtf16 build(const std::vector<std::u16string> &keys,
+                                  const std::vector<int32_t> &termIds);
+
+    void saveToFile(const std::string &path) const;
+    static DoubleArrayUtf16 loadFromFile(const std::string &path);
+
+private:
+    static void write_u64(std::ostream &os, uint64_t v);
+    static void read_u64(std::istream &is, uint64_t &v);
+};
@@ -1,12 +1,18 @@
 #include "louds/louds_utf16_reader.hpp"
 
-LOUDSReaderUtf16::LOUDSReaderUtf16(const BitVector &lbs,
-                                   const BitVector &isLeaf,
-                                   std::vector<char16_t> labels)
-    : LBS_(lbs),
-      isLeaf_(isLeaf),
-      labels_(std::move(labels)),
-      lbsSucc_(LBS_)
+#include "common/alphabet_labels_utf16.hpp"
+
+LOUDSReaderUtf16::LOUDSReaderUtf16(BitVector lbs,
+                                   BitVector isLeaf,
+                                   std::vector<char16_t> labels,
+                                   const std::vector<uint8_t> *lbsIndex)
+    : LBS_(std::move(lbs)),
+      isLeaf_(std::move(isLeaf)),
+      labelsStore_(std::move(labels)),
+      lbsBits_(LBS_),
+      isLeafBits_(isLeaf_),
+      labels_(labelsStore_),
+      lbsSucc_(SuccinctBitVector::adopt(LBS_, lbsIndex))
 {
 }
 
@@ -15,73 +21,121 @@ int LOUDSReaderUtf16::firstChild(int pos) const
     const int y = lbsSucc_.select0(lbsSucc_.rank1(pos)) + 1;
     if (y < 0)
         return -1;
-    if (static_cast<size_t>(y) >= LBS_.size())
+    if (static_cast<size_t>(y) >= lbsBits_.size())
         return -1;
-    return (LBS_.get(static_cast<size_t>(y)) ? y : -1);
+    return (lbsBits_.get(static_cast<size_t>(y)) ? y : -1);
 }
 
 int LOUDSReaderUtf16::traverse(int pos, char16_t c) const
 {
-    int childPos = firstChild(pos);
+    const int childPos = firstChild(pos);
     if (childPos == -1)
         return -1;
 
-    while (static_cast<size_t>(childPos) < LBS_.size() &&
-           LBS_.get(static_cast<size_t>(childPos)))
-    {
-        const int labelIndex = lbsSucc_.rank1(childPos);
-        if (labelIndex >= 0 && static_cast<size_t>(labelIndex) < labels_.size())
+    // The children are the run of 1s at childPos, and their labels (sorted by
+    // the converter) sit contiguously from rank1(childPos): one rank per step.
+    const size_t fanout = lbsBits_.onesRun(static_cast<size_t>(childPos));
+    const int k = labelops::findSorted(labels_, static_cast<size_t>(lbsSucc_.rank1(childPos)), fanout, c);
+    return k < 0 ? -1 : childPos + k;
+}
+
+int LOUDSReaderUtf16::step(int pos, std::u16string_view key, size_t i) const
+{
+    if (i < 2 && !rootDispatch_.empty())
+        return i == 0 ? rootDispatch_.lookup1(key[0]) : rootDispatch_.lookup2(key[0], key[1]);
+    return traverse(pos, key[i]);
+}
+
+void LOUDSReaderUtf16::enableRootDispatch()
+{
+    rootDispatch_.build(
+        [this](int pos)
         {
-            if (labels_[static_cast<size_t>(labelIndex)] == c)
-                return childPos;
-        }
-        childPos += 1;
-    }
-    return -1;
+            std::vector<std::pair<char16_t, int32_t>> out;
+            const int childPos = firstChild(pos);
+            if (childPos == -1)
+                return out;
+            const size_t fanout = lbsBits_.onesRun(static_cast<size_t>(childPos));
+            const size_t firstLabel = static_cast<size_t>(lbsSucc_.rank1(childPos));
+            for (size_t k = 0; k < fanout && firstLabel + k < labels_.size(); ++k)
+                out.emplace_back(labels_[firstLabel + k], childPos + static_cast<int32_t>(k));
+            return out;
+        });
 }
 
-std::vector<std::u16string> LOUDSReaderUtf16::commonPrefixSearch(const std::u16string &str) const
+size_t LOUDSReaderUtf16::commonPrefixSearch(std::u16string_view str,
+                                            std::vector<uint32_t> &lengths,
+                                            std::vector<int32_t> *nodes) const
 {
-    std::vector<char16_t> resultTemp;
-    std::vector<std::u16string> result;
+    lengths.clear();
+    if (nodes)
+        nodes->clear();
 
     int n = 0;
-    for (char16_t c : str)
+    for (size_t i = 0; i < str.size(); ++i)
     {
-        n = traverse(n, c);
+        n = step(n, str, i);
         if (n == -1)
             break;
 
-        const int index = lbsSucc_.rank1(n);
-        if (index < 0 || static_cast<size_t>(index) >= labels_.size())
-            break;
-
-        resultTemp.push_back(labels_[static_cast<size_t>(index)]);
-
-        if (static_cast<size_t>(n) < isLeaf_.size() && isLeaf_.get(static_cast<size_t>(n)))
+        if (static_cast<size_t>(n) < isLeafBits_.size() && isLeafBits_.get(static_cast<size_t>(n)))
         {
-            std::u16string tempStr(resultTemp.begin(), resultTemp.end());
-            if (!result.empty())
-            {
-                result.push_back(result[0] + tempStr);
-            }
-            else
-            {
-                result.push_back(tempStr);
-                resultTemp.clear();
-            }
+            lengths.push_back(static_cast<uint32_t>(i + 1));
+            if (nodes)
+                nodes->push_back(n);
         }
     }
+    return lengths.size();
+}
+
+std::vector<std::u16string> LOUDSReaderUtf16::commonPrefixSearch(const std::u16string &str) const
+{
+    std::vector<uint32_t> lengths;
+    commonPrefixSearch(str, lengths);
+
+    std::vector<std::u16string> result;
+    result.reserve(lengths.size());
+    for (uint32_t len : lengths)
+        result.emplace_back(str, 0, len);
     return result;
 }
 
+void LOUDSReaderUtf16::enableParentTable()
+{
+    if (!parents_.empty())
+        return;
+    parents_.adopt(ParentTableUtf16::serialize(lbsBits_));
+}
+
+bool LOUDSReaderUtf16::parentsFit() const
+{
+    return parents_.size() == static_cast<size_t>(lbsSucc_.totalOnes()) + 1;
+}
+
 std::u16string LOUDSReaderUtf16::getLetter(int nodeIndex) const
 {
     if (nodeIndex < 0)
         return u"";
-    if (static_cast<size_t>(nodeIndex) >= LBS_.size())
+    if (static_cast<size_t>(nodeIndex) >= lbsBits_.size())
         return u"";
 
+    // 親の表があれば rank1 を 1 回引いた後は表だけで根まで上る。
+    // 下の経路と同じく空白 (U+0020) のラベルは出力しない
+    if (!parents_.empty() && lbsBits_.get(static_cast<size_t>(nodeIndex)))
+    {
+        size_t L = static_cast<size_t>(lbsSucc_.rank1(nodeIndex));
+        std::u16string out(parents_.depth(L), u' ');
+        size_t i = out.size();
+        for (size_t d = out.size(); d > 0; --d)
+        {
+            if (labels_[L] != u' ')
+                out[--i] = labels_[L];
+            L = parents_.parent(L);
+        }
+        out.erase(0, i);
+        return out;
+    }
+
     std::u16string out;
     int current = nodeIndex;
 
@@ -129,31 +183,23 @@ int LOUDSReaderUtf16::search(int index, const std::u16string &chars, size_t word
     if (currentIndex < 0)
         return -1;
 
-    while (static_cast<size_t>(currentIndex) < LBS_.size() &&
-           LBS_.get(static_cast<size_t>(currentIndex)))
+    while (wordOffset < chars.size())
     {
-        if (wordOffset >= chars.size())
-            return currentIndex;
-
-        int charIndex = lbsSucc_.rank1(currentIndex);
-        if (charIndex < 0 || static_cast<size_t>(charIndex) >= labels_.size())
+        // Same sibling-run lookup as traverse().
+        const size_t fanout = lbsBits_.onesRun(static_cast<size_t>(currentIndex));
+        const int charIndex = lbsSucc_.rank1(currentIndex);
+        const int k = labelops::findSorted(labels_, static_cast<size_t>(charIndex), fanout, chars[wordOffset]);
+        if (k < 0)
             return -1;
 
-        const char16_t currentLabel = labels_[static_cast<size_t>(charIndex)];
-        const char16_t currentChar = chars[wordOffset];
-
-        if (currentChar == currentLabel)
-        {
-            if (wordOffset + 1 == chars.size())
-                return currentIndex;
-
-            const int nextIndex = lbsSucc_.select0(charIndex) + 1;
-            if (nextIndex < 0)
-                return -1;
-            return search(nextIndex, chars, wordOffset + 1);
-        }
+        currentIndex += k;
+        if (wordOffset + 1 == chars.size())
+            return currentIndex;
 
-        currentIndex++;
+        currentIndex = lbsSucc_.select0(charIndex + k) + 1;
+        if (currentIndex <= 0)
+            return -1;
+        ++wordOffset;
     }
     return -1;
 }
@@ -163,11 +209,6 @@ void LOUDSReaderUtf16::read_u64(std::istream &is, uint64_t &v)
     is.read(reinterpret_cast<char *>(&v), sizeof(v));
 }
 
-void LOUDSReaderUtf16::read_u16(std::istream &is, uint16_t &v)
-{
-    is.read(reinterpret_cast<char *>(&v), sizeof(v));
-}
-
 std::vector<uint64_t> LOUDSReaderUtf16::read_u64_vec(std::istream &is)
 {
     uint64_t n = 0;
@@ -191,6 +232,13 @@ BitVector LOUDSReaderUtf16::readBitVector(std::istream &is)
     return bv;
 }
 
+std::vector<char16_t> LOUDSReaderUtf16::decodeLabels8(std::span<const uint8_t> bytes)
+{
+    AlphabetLabelsUtf16 labels8;
+    labels8.parse(bytes);
+    return labels8.decode();
+}
+
 LOUDSReaderUtf16 LOUDSReaderUtf16::loadFromFile(const std::string &path)
 {
     std::ifstream ifs(path, std::ios::binary);
@@ -205,13 +253,55 @@ LOUDSReaderUtf16 LOUDSReaderUtf16::loadFromFile(const std::string &path)
 
     std::vector<char16_t> labels;
     labels.resize(static_cast<size_t>(labelN));
+    if (labelN > 0)
+    {
+        ifs.read(reinterpret_cast<char *>(labels.data()),
+                 static_cast<std::streamsize>(labelN * sizeof(char16_t)));
+    }
+
+    // Optional trailing sections (also found in yomi_termid.louds, after termIds).
+    const FileSections sections = FileSections::read(ifs);
+    if (const auto *bytes = sections.find(FileSections::kLabels8); bytes && labels.empty())
+        labels = decodeLabels8(*bytes);
+
+    LOUDSReaderUtf16 r(std::move(lbs), std::move(isLeaf), std::move(labels),
+                       sections.find(FileSections::kLbsIndex));
+    if (const auto *bytes = sections.find(FileSections::kParents))
+    {
+        if (!r.parents_.adopt(*bytes) || !r.parentsFit())
+            throw std::runtime_error("malformed parent table: " + path);
+    }
+    return r;
+}
 
-    for (size_t i = 0; i < static_cast<size_t>(labelN); ++i)
+LOUDSReaderUtf16 LOUDSReaderUtf16::mapFromFile(const std::string &path)
+{
+    LOUDSReaderUtf16 r;
+    r.map_ = MappedFile::open(path);
+
+    MappedReader in(r.map_->data(), r.map_->size(), "LOUDSReaderUtf16: " + path);
+    r.lbsBits_ = in.bits();
+    r.isLeafBits_ = in.bits();
+    const uint64_t labelN = in.u64();
+    if (labelN % 4 != 0)
+        return loadFromFile(path); // written before labels were padded (unaligned layout): fall back to a copy
+    r.labels_ = in.array<char16_t>(static_cast<size_t>(labelN));
+    if (const auto bytes = FileSections::locate(r.map_->data(), r.map_->size(), FileSections::kLabels8);
+        bytes && r.labels_.empty())
     {
-        uint16_t v = 0;
-        read_u16(ifs, v);
-        labels[i] = static_cast<char16_t>(v);
+        // --labels8 file: the 16-bit labels are not on disk, so this copy is the one exception to zero-copy
+        r.labelsStore_ = decodeLabels8(*bytes);
+        r.labels_ = r.labelsStore_;
     }
 
-    return LOUDSReaderUtf16(lbs, isLeaf, std::move(labels));
+    r.lbsSucc_ = SuccinctBitVector::adoptView(
+        r.lbsBits_,
+        FileSections::locate(r.map_->data(), r.map_->size(), FileSections::kLbsIndex));
+
+    if (const auto parents = FileSections::locate(r.map_->data(), r.map_->size(), FileSections::kParents))
+    {
+        if (!r.parents_.view(*parents) || !r.parentsFit())
+            in.fail("malformed parent table");
+    }
+    return r;
 }
@@ -3,46 +3,112 @@
 #include <cstddef>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <stdexcept>
 #include <algorithm>
+#include <memory>
+#include <span>
 
 #include "common/bit_vector_utf16.hpp"
+#include "common/file_sections_utf16.hpp"
+#include "common/label_ops_utf16.hpp"
+#include "common/mapped_file_utf16.hpp"
+#include "common/parent_table_utf16.hpp"
+#include "common/root_dispatch_utf16.hpp"
 #include "common/succinct_bit_vector_utf16.hpp"
 
+// 読み取り専用の LOUDS (UTF-16)。
+// - loadFromFile: ファイルを読み込んでヒープに保持する
+// - mapFromFile : ファイルを mmap し、LBS/isLeaf/labels/索引をマップ上のビューとして使う
+// どちらでも検索は同じビュー (lbsBits_ / isLeafBits_ / labels_) を通る。
+// ビューが自前のバッファを指すので copy は不可、move は可。
 class LOUDSReaderUtf16
 {
 public:
-    LOUDSReaderUtf16(const BitVector &lbs,
-                     const BitVector &isLeaf,
-                     std::vector<char16_t> labels);
+    // lbsIndex: persisted SuccinctBitVector index of lbs (FileSections::kLbsIndex).
+    // When absent or stale, the index is built from lbs.
+    LOUDSReaderUtf16(BitVector lbs,
+                     BitVector isLeaf,
+                     std::vector<char16_t> labels,
+                     const std::vector<uint8_t> *lbsIndex = nullptr);
 
+    // 割り当てなしの commonPrefixSearch。ヒットはすべて str の接頭辞なので、
+    // 文字列の代わりに一致長 (短い順) を lengths に入れる。nodes を渡すと
+    // 各ヒットのノード位置 (getLetter に渡せる) も同じ順で入れる。
+    // どちらも最初に clear するので、呼び出し側で使い回せば再確保しない。
+    // ヒット数 (lengths.size()) を返す。
+    size_t commonPrefixSearch(std::u16string_view str,
+                              std::vector<uint32_t> &lengths,
+                              std::vector<int32_t> *nodes = nullptr) const;
+
+    // 一致した接頭辞そのもの (短い順)。上の版に文字列化を足したもの。
     std::vector<std::u16string> commonPrefixSearch(const std::u16string &str) const;
 
+    // 任意: ルートから 1〜2 文字目までを表引きにする RootDispatchUtf16 を作る。
+    // 以後 commonPrefixSearch の最初の 1〜2 歩は rank/select を使わない。
+    void enableRootDispatch();
+
+    // 任意: 親の表 (ParentTableUtf16) を LBS から作る。ファイルに kParents が
+    // あれば読み込み時に使うので不要。以後 getLetter は 1 文字ごとに表を 1 回引くだけ。
+    void enableParentTable();
+    bool hasParentTable() const { return !parents_.empty(); }
+
     // ルートから nodeIndex までのラベルを復元
     std::u16string getLetter(int nodeIndex) const;
 
     int getNodeIndex(const std::u16string &s) const;
     int getNodeId(const std::u16string &s) const;
 
-    const std::vector<char16_t> &getAllLabels() const { return labels_; }
+    LOUDSReaderUtf16(const LOUDSReaderUtf16 &) = delete;
+    LOUDSReaderUtf16 &operator=(const LOUDSReaderUtf16 &) = delete;
+    LOUDSReaderUtf16(LOUDSReaderUtf16 &&) = default;
+    LOUDSReaderUtf16 &operator=(LOUDSReaderUtf16 &&) = default;
+
+    std::span<const char16_t> getAllLabels() const { return labels_; }
 
     static LOUDSReaderUtf16 loadFromFile(const std::string &path);
 
+    // Zero-copy: the reader keeps the mapping alive and reads it in place.
+    // Works for .louds files with or without the persisted LBS index.
+    // Files written before labels were padded to a multiple of 4 fall back to
+    // loadFromFile. Both loaders decode --labels8 labels (FileSections::kLabels8) to 16 bits.
+    static LOUDSReaderUtf16 mapFromFile(const std::string &path);
+
 private:
+    LOUDSReaderUtf16() = default;
+
+    // Heap storage (empty when mapped)
     BitVector LBS_;
     BitVector isLeaf_;
-    std::vector<char16_t> labels_;
+    std::vector<char16_t> labelsStore_;
+    std::shared_ptr<const MappedFile> map_;
+
+    // What lookups read: views into the storage above or into map_
+    BitVectorView lbsBits_;
+    BitVectorView isLeafBits_;
+    std::span<const char16_t> labels_;
 
     SuccinctBitVector lbsSucc_;
 
+    // enableRootDispatch() を呼ぶまで空
+    RootDispatchUtf16 rootDispatch_;
+
+    // kParents を読んだか enableParentTable() を呼ぶまで空
+    ParentTableUtf16 parents_;
+    // 表の大きさがこの LBS と合うか (合わなければ壊れたファイル)
+    bool parentsFit() const;
+
     int firstChild(int pos) const;
     int traverse(int pos, char16_t c) const;
+    // key[0, i) のノード pos から key[i] で進む。有効なら i < 2 は rootDispatch_ を引く。
+    int step(int pos, std::u16string_view key, size_t i) const;
 
     int search(int index, const std::u16string &chars, size_t wordOffset) const;
 
     static void read_u64(std::istream &is, uint64_t &v);
-    static void read_u16(std::istream &is, uint16_t &v);
     static std::vector<uint64_t> read_u64_vec(std::istream &is);
     static BitVector readBitVector(std::istream &is);
+    // kLabels8 (--labels8) section -> 16-bit labels; throws if malformed
+    static std::vector<char16_t> decodeLabels8(std::span<const uint8_t> bytes);
 };
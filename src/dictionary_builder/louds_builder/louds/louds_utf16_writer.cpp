@@ -1,6 +1,9 @@
 #include "louds/louds_utf16_writer.hpp"
 #include <stdexcept>
 
+#include "common/parent_table_utf16.hpp"
+#include "common/succinct_bit_vector_utf16.hpp"
+
 LOUDSUtf16::LOUDSUtf16()
 {
     // 既存実装互換のためのダミー要素
@@ -155,7 +158,7 @@ BitVector LOUDSUtf16::readBitVector(std::istream &is)
     return bv;
 }
 
-void LOUDSUtf16::saveToFile(const std::string &path) const
+void LOUDSUtf16::saveToFile(const std::string &path, bool withIndex, bool withParents) const
 {
     std::ofstream ofs(path, std::ios::binary);
     if (!ofs)
@@ -164,11 +167,27 @@ void LOUDSUtf16::saveToFile(const std::string &path) const
     writeBitVector(ofs, LBS);
     writeBitVector(ofs, isLeaf);
 
-    write_u64(ofs, static_cast<uint64_t>(labels.size()));
+    // labels: padded with dummy labels to a multiple of 4 so that everything
+    // after them stays 8-byte aligned for mapFromFile. rank1 never reaches the
+    // padding (at most labels.size() - 1), so older readers are unaffected.
+    const size_t labelN = (labels.size() + 3) & ~size_t{3};
+    write_u64(ofs, static_cast<uint64_t>(labelN));
     for (char16_t ch : labels)
     {
         write_u16(ofs, static_cast<uint16_t>(ch));
     }
+    for (size_t i = labels.size(); i < labelN; ++i)
+    {
+        write_u16(ofs, static_cast<uint16_t>(u' '));
+    }
+
+    FileSections sections;
+    if (withIndex)
+        sections.add(FileSections::kLbsIndex, SuccinctBitVector(LBS).serializeIndex());
+    if (withParents)
+        sections.add(FileSections::kParents, ParentTableUtf16::serialize(BitVectorView(LBS)));
+    if (!sections.empty())
+        sections.write(ofs);
 }
 
 LOUDSUtf16 LOUDSUtf16::loadFromFile(const std::string &path)
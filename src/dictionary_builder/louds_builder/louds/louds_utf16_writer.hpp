@@ -7,6 +7,7 @@
 #include <istream>
 
 #include "common/bit_vector_utf16.hpp"
+#include "common/file_sections_utf16.hpp"
 
 // UTF-16 writer は char32_t 版の LOUDS と同名にすると
 // リンカで ODR/ABI 衝突するため、別名にしています。
@@ -27,7 +28,11 @@ public:
 
     std::vector<std::u16string> commonPrefixSearch(const std::u16string &str) const;
 
-    void saveToFile(const std::string &path) const;
+    // withIndex: append the precomputed LBS rank/select index as a FileSections
+    // section so readers can adopt it instead of rebuilding it.
+    // withParents: append the parent/depth table (FileSections::kParents) that
+    // lets LOUDSReaderUtf16::getLetter climb without rank/select.
+    void saveToFile(const std::string &path, bool withIndex = false, bool withParents = false) const;
     static LOUDSUtf16 loadFromFile(const std::string &path);
 
     bool equals(const LOUDSUtf16 &other) const;
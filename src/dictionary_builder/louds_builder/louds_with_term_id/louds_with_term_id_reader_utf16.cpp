@@ -1,36 +1,128 @@
 #include "louds_with_term_id_reader_utf16.hpp"
 
+#include <algorithm>
+#include <array>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
 LOUDSWithTermIdReaderUtf16::LOUDSWithTermIdReaderUtf16(const LOUDSWithTermIdUtf16 &trie)
     : LBS_(trie.LBS),
       isLeaf_(trie.isLeaf),
       labels_(trie.labels),
-      termIdByNodeId_(trie.termIdByNodeId)
+      termIdByNodeId_(trie.termIdByNodeId),
+      lbsSucc_(SuccinctBitVector::adoptView(
+          LBS_, trie.LBSIndex.empty() ? std::nullopt : std::optional(std::span<const uint8_t>(trie.LBSIndex)))),
+      leafRank_(trie.termIdsByLeafRank)
+{
+    if (leafRank_)
+    {
+        isLeafSucc_ = SuccinctBitVector::adoptView(
+            isLeaf_,
+            trie.isLeafIndex.empty() ? std::nullopt : std::optional(std::span<const uint8_t>(trie.isLeafIndex)),
+            /*withSelectHints=*/false);
+    }
+    initLabels8(trie.labels8.empty() ? std::nullopt : std::optional(std::span<const uint8_t>(trie.labels8)));
+    initPredictCosts(trie.subtreeMinCost, trie.leafMinCost);
+}
+
+LOUDSWithTermIdReaderUtf16 LOUDSWithTermIdReaderUtf16::mapFromFile(const std::string &path)
 {
-    // Build select0 table (positions of 0 bits in LBS).
-    // LBS has about 1.8M zeros in your log; storing int positions is acceptable.
-    zeroPos_.clear();
-    zeroPos_.reserve(static_cast<size_t>(LBS_.size()) / 2 + 1);
+    LOUDSWithTermIdReaderUtf16 r;
+    r.map_ = MappedFile::open(path);
 
-    // 1-indexed: put a dummy at index 0
-    zeroPos_.push_back(-1);
+    MappedReader in(r.map_->data(), r.map_->size(), "LOUDSWithTermIdReaderUtf16: " + path);
+    r.LBS_ = in.bits();
+    r.isLeaf_ = in.bits();
+    const uint64_t labelN = in.u64();
+    if (labelN % 4 != 0)
+        return loadFromFile(path); // written before labels were padded: termIds are not aligned, fall back to a copy
+    r.labels_ = in.array<char16_t>(static_cast<size_t>(labelN));
+    const uint64_t termN = in.u64();
+    r.termIdByNodeId_ = in.array<int32_t>(static_cast<size_t>(termN));
 
-    const int n = static_cast<int>(LBS_.size());
-    for (int i = 0; i < n; ++i)
+    r.lbsSucc_ = SuccinctBitVector::adoptView(
+        r.LBS_,
+        FileSections::locate(r.map_->data(), r.map_->size(), FileSections::kLbsIndex));
+
+    if (const auto leafIdx = FileSections::locate(r.map_->data(), r.map_->size(), FileSections::kLeafRankTermIds))
     {
-        if (!LBS_.get(i))
-        {
-            zeroPos_.push_back(i);
-        }
+        r.leafRank_ = true;
+        r.isLeafSucc_ = SuccinctBitVector::adoptView(
+            r.isLeaf_, leafIdx->empty() ? std::nullopt : leafIdx, /*withSelectHints=*/false);
+    }
+    r.initLabels8(FileSections::locate(r.map_->data(), r.map_->size(), FileSections::kLabels8));
+
+    if (const auto costs = FileSections::locate(r.map_->data(), r.map_->size(), FileSections::kPredictCosts))
+    {
+        std::span<const int16_t> subtreeMin;
+        std::span<const int16_t> leafMin;
+        if (!LOUDSWithTermIdUtf16::viewPredictCosts(*costs, r.LBS_, r.isLeaf_, subtreeMin, leafMin))
+            in.fail("malformed predictive-search costs");
+        r.initPredictCosts(subtreeMin, leafMin);
     }
+    return r;
 }
 
-int LOUDSWithTermIdReaderUtf16::select0_1indexed(int k) const
+LOUDSWithTermIdReaderUtf16 LOUDSWithTermIdReaderUtf16::loadFromFile(const std::string &path)
 {
-    if (k <= 0)
-        return -1;
-    if (k >= static_cast<int>(zeroPos_.size()))
-        return -1;
-    return zeroPos_[k];
+    // The trie lives on the heap so the views stay valid when the reader is moved.
+    auto trie = std::make_shared<const LOUDSWithTermIdUtf16>(LOUDSWithTermIdUtf16::loadFromFile(path));
+    LOUDSWithTermIdReaderUtf16 r(*trie);
+    r.owned_ = std::move(trie);
+    return r;
+}
+
+void LOUDSWithTermIdReaderUtf16::initLabels8(std::optional<std::span<const uint8_t>> section)
+{
+    if (!section)
+        return;
+    labels8_.parse(*section);
+    labels_ = {};
+}
+
+void LOUDSWithTermIdReaderUtf16::initPredictCosts(std::span<const int16_t> subtreeMin, std::span<const int16_t> leafMin)
+{
+    if (subtreeMin.empty())
+        return;
+    subtreeMinCost_ = subtreeMin;
+    leafMinCost_ = leafMin;
+    if (!leafRank_)
+        isLeafSucc_ = SuccinctBitVector::adoptView(isLeaf_, std::nullopt, /*withSelectHints=*/false);
+}
+
+char16_t LOUDSWithTermIdReaderUtf16::labelAt(size_t i) const
+{
+    return labels8_.empty() ? labels_[i] : labels8_.at(i);
+}
+
+size_t LOUDSWithTermIdReaderUtf16::labelCount() const
+{
+    return labels8_.empty() ? labels_.size() : labels8_.size();
+}
+
+int LOUDSWithTermIdReaderUtf16::findLabel(size_t first, size_t n, char16_t c) const
+{
+    if (!labels8_.empty())
+        return labels8_.find(first, n, c);
+    return labelops::findSorted(labels_, first, n, c);
+}
+
+void LOUDSWithTermIdReaderUtf16::enableRootDispatch()
+{
+    rootDispatch_.build(
+        [this](int pos)
+        {
+            std::vector<std::pair<char16_t, int32_t>> out;
+            const int childPos = firstChild(pos);
+            if (childPos < 0)
+                return out;
+            const size_t fanout = LBS_.onesRun(static_cast<size_t>(childPos));
+            const size_t firstLabel = static_cast<size_t>(lbsSucc_.rank1(childPos));
+            for (size_t k = 0; k < fanout && firstLabel + k < labelCount(); ++k)
+                out.emplace_back(labelAt(firstLabel + k), childPos + static_cast<int32_t>(k));
+            return out;
+        });
 }
 
 int LOUDSWithTermIdReaderUtf16::firstChild(int pos) const
@@ -40,8 +132,8 @@ int LOUDSWithTermIdReaderUtf16::firstChild(int pos) const
     //   firstChild(pos) = select0(rank1(pos)) + 1
     //
     // rank1(pos) is treated as 1-indexed count in the original code.
-    const int r1 = static_cast<int>(LBS_.rank1(pos));
-    const int z = select0_1indexed(r1);
+    const int r1 = lbsSucc_.rank1(pos);
+    const int z = lbsSucc_.select0(r1);
     if (z < 0)
         return -1;
     return z + 1;
@@ -49,23 +141,22 @@ int LOUDSWithTermIdReaderUtf16::firstChild(int pos) const
 
 int LOUDSWithTermIdReaderUtf16::traverse(int pos, char16_t c) const
 {
-    int childPos = firstChild(pos);
+    const int childPos = firstChild(pos);
     if (childPos < 0)
         return -1;
 
-    // Children are encoded as a run of 1s terminated by 0.
-    // Labels are aligned to rank1 positions.
-    while (childPos < static_cast<int>(LBS_.size()) && LBS_.get(childPos))
-    {
-        // labels are indexed by rank1(position) and we have two dummy labels at indices 0 and 1.
-        const int labelIndex = static_cast<int>(LBS_.rank1(childPos));
-        if (labelIndex >= 0 && labelIndex < static_cast<int>(labels_.size()) && labels_[labelIndex] == c)
-        {
-            return childPos;
-        }
-        ++childPos;
-    }
-    return -1;
+    // Children are encoded as a run of 1s terminated by 0, and their labels are
+    // a sorted run starting at rank1(childPos) (two dummy labels at 0 and 1).
+    const size_t fanout = LBS_.onesRun(static_cast<size_t>(childPos));
+    const int k = findLabel(static_cast<size_t>(lbsSucc_.rank1(childPos)), fanout, c);
+    return k < 0 ? -1 : childPos + k;
+}
+
+int LOUDSWithTermIdReaderUtf16::step(int pos, std::u16string_view key, size_t i) const
+{
+    if (i < 2 && !rootDispatch_.empty())
+        return i == 0 ? rootDispatch_.lookup1(key[0]) : rootDispatch_.lookup2(key[0], key[1]);
+    return traverse(pos, key[i]);
 }
 
 int LOUDSWithTermIdReaderUtf16::nodeIdFromPos(int pos) const
@@ -75,18 +166,17 @@ int LOUDSWithTermIdReaderUtf16::nodeIdFromPos(int pos) const
     //   termIdByNodeId.size() = count0(LBS) - 1  (root excluded)
     //
     // So we must subtract 1.
-    const int raw = static_cast<int>(LBS_.rank1(pos));
+    const int raw = lbsSucc_.rank1(pos);
     return raw - 1;
 }
 
-int32_t LOUDSWithTermIdReaderUtf16::getTermId(const std::u16string &key) const
+int32_t LOUDSWithTermIdReaderUtf16::termIdAt(int pos) const
 {
-    int pos = 0; // root
-    for (char16_t ch : key)
+    if (leafRank_)
     {
-        pos = traverse(pos, ch);
-        if (pos < 0)
+        if (pos < 0 || static_cast<size_t>(pos) >= isLeaf_.size() || !isLeaf_.get(static_cast<size_t>(pos)))
             return -1;
+        return isLeafSucc_.rank1(pos) - 1;
     }
 
     const int nodeId = nodeIdFromPos(pos);
@@ -97,6 +187,19 @@ int32_t LOUDSWithTermIdReaderUtf16::getTermId(const std::u16string &key) const
     return (termId >= 0 ? termId : -1);
 }
 
+int32_t LOUDSWithTermIdReaderUtf16::getTermId(const std::u16string &key) const
+{
+    int pos = 0; // root
+    for (size_t i = 0; i < key.size(); ++i)
+    {
+        pos = step(pos, key, i);
+        if (pos < 0)
+            return -1;
+    }
+
+    return termIdAt(pos);
+}
+
 std::pair<size_t, int32_t> LOUDSWithTermIdReaderUtf16::longestPrefixTermId(const std::u16string &key) const
 {
     int pos = 0;
@@ -106,21 +209,415 @@ std::pair<size_t, int32_t> LOUDSWithTermIdReaderUtf16::longestPrefixTermId(const
 
     for (size_t i = 0; i < key.size(); ++i)
     {
-        pos = traverse(pos, key[i]);
+        pos = step(pos, key, i);
+        if (pos < 0)
+            break;
+
+        const int32_t termId = termIdAt(pos);
+        if (termId >= 0)
+        {
+            bestLen = i + 1;
+            bestTermId = termId;
+        }
+    }
+
+    return {bestLen, bestTermId};
+}
+
+size_t LOUDSWithTermIdReaderUtf16::commonPrefixSearch(std::u16string_view key, std::vector<PrefixHit> &out) const
+{
+    out.clear();
+
+    int pos = 0;
+    for (size_t i = 0; i < key.size(); ++i)
+    {
+        pos = step(pos, key, i);
         if (pos < 0)
             break;
 
-        const int nodeId = nodeIdFromPos(pos);
-        if (nodeId >= 0 && nodeId < static_cast<int>(termIdByNodeId_.size()))
+        if (static_cast<size_t>(pos) >= isLeaf_.size() || !isLeaf_.get(static_cast<size_t>(pos)))
+            continue;
+
+        out.push_back(PrefixHit{static_cast<uint32_t>(i + 1), termIdAt(pos)});
+    }
+    return out.size();
+}
+
+std::vector<std::u16string> LOUDSWithTermIdReaderUtf16::commonPrefixSearch(const std::u16string &str) const
+{
+    std::vector<PrefixHit> hits;
+    commonPrefixSearch(str, hits);
+
+    std::vector<std::u16string> result;
+    result.reserve(hits.size());
+    for (const auto &hit : hits)
+        result.emplace_back(str, 0, hit.length);
+    return result;
+}
+
+int LOUDSWithTermIdReaderUtf16::nodeFor(std::u16string_view prefix) const
+{
+    int pos = 0;
+    for (size_t i = 0; i < prefix.size(); ++i)
+    {
+        pos = step(pos, prefix, i);
+        if (pos < 0)
+            return -1;
+    }
+    return pos;
+}
+
+std::u16string LOUDSWithTermIdReaderUtf16::keyOf(int pos) const
+{
+    std::u16string key;
+    while (pos > 0)
+    {
+        key.push_back(labelAt(static_cast<size_t>(lbsSucc_.rank1(pos))));
+        // parent: the node whose 0-terminated child run contains pos
+        pos = lbsSucc_.select1(lbsSucc_.rank0(pos));
+    }
+    std::reverse(key.begin(), key.end());
+    return key;
+}
+
+size_t LOUDSWithTermIdReaderUtf16::predictiveSearch(std::u16string_view prefix,
+                                                    size_t limit,
+                                                    std::vector<PredictiveHit> &out) const
+{
+    out.clear();
+
+    const int start = nodeFor(prefix);
+    if (start < 0 || limit == 0)
+        return 0;
+
+    std::queue<int> q;
+    q.push(start);
+    while (!q.empty() && out.size() < limit)
+    {
+        const int pos = q.front();
+        q.pop();
+
+        if (pos > 0 && isLeaf_.get(static_cast<size_t>(pos)))
+        {
+            const int16_t cost = leafMinCost_.empty()
+                                     ? LOUDSWithTermIdUtf16::kNoCost
+                                     : leafMinCost_[static_cast<size_t>(isLeafSucc_.rank1(pos) - 1)];
+            out.push_back(PredictiveHit{keyOf(pos), termIdAt(pos), cost});
+        }
+
+        const int childPos = firstChild(pos);
+        if (childPos < 0)
+            continue;
+        const size_t fanout = LBS_.onesRun(static_cast<size_t>(childPos));
+        for (size_t c = 0; c < fanout; ++c)
+            q.push(childPos + static_cast<int>(c));
+    }
+    return out.size();
+}
+
+size_t LOUDSWithTermIdReaderUtf16::predictTopK(std::u16string_view prefix,
+                                               size_t k,
+                                               std::vector<PredictiveHit> &out) const
+{
+    if (!hasPredictCosts())
+        throw std::runtime_error("LOUDSWithTermIdReaderUtf16: trie has no predictive-search costs");
+    out.clear();
+
+    const int start = nodeFor(prefix);
+    if (start < 0 || k == 0)
+        return 0;
+
+    // (cost, pos, isWord): a subtree entry is keyed by the cheapest word below
+    // it, so it is never popped after a word it could beat. Smaller pos first
+    // on ties keeps BFS order.
+    using Entry = std::tuple<int16_t, int, bool>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+
+    const auto subtreeCost = [this](int pos)
+    {
+        return subtreeMinCost_[static_cast<size_t>(lbsSucc_.rank1(pos) - 1)];
+    };
+
+    if (subtreeCost(start) != LOUDSWithTermIdUtf16::kNoCost)
+        heap.emplace(subtreeCost(start), start, false);
+
+    while (!heap.empty() && out.size() < k)
+    {
+        const auto [cost, pos, isWord] = heap.top();
+        heap.pop();
+
+        if (isWord)
+        {
+            out.push_back(PredictiveHit{keyOf(pos), termIdAt(pos), cost});
+            continue;
+        }
+
+        if (pos > 0 && isLeaf_.get(static_cast<size_t>(pos)))
+        {
+            const int16_t wordCost = leafMinCost_[static_cast<size_t>(isLeafSucc_.rank1(pos) - 1)];
+            if (wordCost != LOUDSWithTermIdUtf16::kNoCost)
+                heap.emplace(wordCost, pos, true);
+        }
+
+        const int childPos = firstChild(pos);
+        if (childPos < 0)
+            continue;
+        const size_t fanout = LBS_.onesRun(static_cast<size_t>(childPos));
+        for (size_t c = 0; c < fanout; ++c)
         {
-            const int32_t termId = termIdByNodeId_[nodeId];
-            if (termId >= 0)
+            const int child = childPos + static_cast<int>(c);
+            const int16_t childCost = subtreeCost(child);
+            if (childCost != LOUDSWithTermIdUtf16::kNoCost)
+                heap.emplace(childCost, child, false);
+        }
+    }
+    return out.size();
+}
+
+namespace
+{
+    // Hiragana with its dakuten/handakuten and small forms folded onto the
+    // plain kana (が→か, ぱ→は, っ→つ, ゃ→や, ...). Other characters map to themselves.
+    char16_t kanaFamily(char16_t c)
+    {
+        if (c >= 0x3041 && c <= 0x304A) // ぁあぃい...ぉお
+            return static_cast<char16_t>(0x3042 + (c - 0x3041) / 2 * 2);
+        if (c >= 0x304B && c <= 0x3062) // かが...ちぢ
+            return static_cast<char16_t>(0x304B + (c - 0x304B) / 2 * 2);
+        if (c >= 0x3063 && c <= 0x3065) // っつづ
+            return 0x3064;
+        if (c >= 0x3066 && c <= 0x3069) // てでとど
+            return static_cast<char16_t>(0x3066 + (c - 0x3066) / 2 * 2);
+        if (c >= 0x306F && c <= 0x307D) // はばぱ...ほぼぽ
+            return static_cast<char16_t>(0x306F + (c - 0x306F) / 3 * 3);
+        if (c >= 0x3083 && c <= 0x3088) // ゃやゅゆょよ
+            return static_cast<char16_t>(0x3084 + (c - 0x3083) / 2 * 2);
+        if (c == 0x308E) // ゎ
+            return 0x308F;
+        if (c == 0x3094) // ゔ
+            return 0x3046;
+        if (c == 0x3095) // ゕ
+            return 0x304B;
+        if (c == 0x3096) // ゖ
+            return 0x3051;
+        return c;
+    }
+
+    // The other members of c's kana family (at most 2: か→が, は→ば,ぱ), or none.
+    size_t kanaVariants(char16_t c, char16_t (&out)[2])
+    {
+        static const auto table = []
+        {
+            constexpr char16_t kFirst = 0x3041;
+            constexpr char16_t kLast = 0x3096;
+            std::vector<std::array<char16_t, 2>> t(kLast - kFirst + 1, {u'\0', u'\0'});
+            for (char16_t a = kFirst; a <= kLast; ++a)
             {
-                bestLen = i + 1;
-                bestTermId = termId;
+                size_t n = 0;
+                for (char16_t b = kFirst; b <= kLast && n < 2; ++b)
+                {
+                    if (a != b && kanaFamily(a) == kanaFamily(b))
+                        t[a - kFirst][n++] = b;
+                }
             }
+            return t;
+        }();
+
+        if (c < 0x3041 || c > 0x3096)
+            return 0;
+        const auto &v = table[c - 0x3041];
+        out[0] = v[0];
+        out[1] = v[1];
+        return v[0] == u'\0' ? 0 : v[1] == u'\0' ? 1 : 2;
+    }
+} // namespace
+
+void LOUDSWithTermIdReaderUtf16::fuzzyWalk(int pos, size_t i, uint16_t cost, std::u16string_view input,
+                                           const FuzzyOptions &opt, std::vector<FuzzyHit> &out) const
+{
+    if (pos > 0 && i > 0 && isLeaf_.get(static_cast<size_t>(pos)))
+        out.push_back(FuzzyHit{static_cast<uint32_t>(i), termIdAt(pos), cost, pos});
+
+    const uint16_t left = static_cast<uint16_t>(opt.maxCost - cost);
+
+    // Deletion: skip an input character. Not at the root, where it would only
+    // repeat the search that starts one position later.
+    if (pos > 0 && i < input.size() && opt.deleteCost <= left)
+        fuzzyWalk(pos, i + 1, static_cast<uint16_t>(cost + opt.deleteCost), input, opt, out);
+
+    const uint16_t cheapest = std::min({opt.similarCost, opt.substituteCost, opt.insertCost});
+    if (cheapest > left)
+    {
+        // No edit fits any more: the rest is an exact walk. (Not step(): after
+        // an edit pos is not the node for input[0, i), so no root dispatch.)
+        if (i < input.size())
+        {
+            const int child = traverse(pos, input[i]);
+            if (child >= 0)
+                fuzzyWalk(child, i + 1, cost, input, opt, out);
         }
+        return;
     }
 
-    return {bestLen, bestTermId};
+    if (std::min(opt.substituteCost, opt.insertCost) > left)
+    {
+        // Only a kana-family substitution fits: look the variants up directly
+        // instead of scanning every child.
+        if (i >= input.size())
+            return;
+        const int child = traverse(pos, input[i]);
+        if (child >= 0)
+            fuzzyWalk(child, i + 1, cost, input, opt, out);
+
+        char16_t variants[2];
+        const size_t nv = kanaVariants(input[i], variants);
+        for (size_t v = 0; v < nv; ++v)
+        {
+            const int alt = traverse(pos, variants[v]);
+            if (alt >= 0)
+                fuzzyWalk(alt, i + 1, static_cast<uint16_t>(cost + opt.similarCost), input, opt, out);
+        }
+        return;
+    }
+
+    const int childPos = firstChild(pos);
+    if (childPos < 0)
+        return;
+    const size_t fanout = LBS_.onesRun(static_cast<size_t>(childPos));
+    const size_t firstLabel = static_cast<size_t>(lbsSucc_.rank1(childPos));
+    const char16_t c = i < input.size() ? input[i] : u'\0';
+    const char16_t family = kanaFamily(c);
+
+    for (size_t k = 0; k < fanout && firstLabel + k < labelCount(); ++k)
+    {
+        const int child = childPos + static_cast<int>(k);
+        const char16_t label = labelAt(firstLabel + k);
+
+        if (i < input.size())
+        {
+            if (label == c)
+            {
+                fuzzyWalk(child, i + 1, cost, input, opt, out);
+            }
+            else
+            {
+                const uint16_t sub = kanaFamily(label) == family ? opt.similarCost : opt.substituteCost;
+                if (sub <= left)
+                    fuzzyWalk(child, i + 1, static_cast<uint16_t>(cost + sub), input, opt, out);
+            }
+        }
+
+        // Insertion: the key has a character the input lacks.
+        if (opt.insertCost <= left)
+            fuzzyWalk(child, i, static_cast<uint16_t>(cost + opt.insertCost), input, opt, out);
+    }
+}
+
+size_t LOUDSWithTermIdReaderUtf16::fuzzyCommonPrefixSearch(std::u16string_view input,
+                                                           const FuzzyOptions &opt,
+                                                           std::vector<FuzzyHit> &out) const
+{
+    out.clear();
+    fuzzyWalk(0, 0, 0, input, opt, out);
+
+    // Several edit paths can reach the same hit; keep the cheapest.
+    std::sort(out.begin(), out.end(), [](const FuzzyHit &a, const FuzzyHit &b)
+              { return std::tie(a.length, a.termId, a.cost) < std::tie(b.length, b.termId, b.cost); });
+    out.erase(std::unique(out.begin(), out.end(), [](const FuzzyHit &a, const FuzzyHit &b)
+                          { return a.length == b.length && a.termId == b.termId; }),
+              out.end());
+    std::stable_sort(out.begin(), out.end(), [](const FuzzyHit &a, const FuzzyHit &b)
+                     { return std::tie(a.length, a.cost) < std::tie(b.length, b.cost); });
+    return out.size();
+}
+
+int LOUDSWithTermIdReaderUtf16::acGoto(int pos, char16_t c) const
+{
+    if (pos == 0 && !rootDispatch_.empty())
+        return rootDispatch_.lookup1(c);
+    return traverse(pos, c);
+}
+
+void LOUDSWithTermIdReaderUtf16::enableAhoCorasick()
+{
+    const size_t nodeN = static_cast<size_t>(lbsSucc_.totalOnes());
+    std::vector<int32_t> fail(nodeN, 0);
+    std::vector<int32_t> out(nodeN, -1);
+    std::vector<uint16_t> depth(nodeN, 0);
+
+    // LBS lists the nodes in BFS order, so a parent's links are final before
+    // its children are reached. Node k is the k-th 1 (root = 0); its parent is
+    // node (number of 0s before it) - 1.
+    size_t k = 0;
+    size_t zeros = 0;
+    for (size_t pos = 0; pos < LBS_.size(); ++pos)
+    {
+        if (!LBS_.get(pos))
+        {
+            ++zeros;
+            continue;
+        }
+
+        if (k > 0)
+        {
+            const size_t parent = zeros - 1;
+            const char16_t c = labelAt(k + 1);
+            depth[k] = static_cast<uint16_t>(depth[parent] + 1);
+
+            int32_t f = 0;
+            if (parent != 0)
+            {
+                // Longest proper suffix of parent's key that can be extended by c.
+                f = fail[parent];
+                int32_t g = acGoto(f, c);
+                while (g < 0 && f != 0)
+                {
+                    f = fail[static_cast<size_t>(lbsSucc_.rank1(f) - 1)];
+                    g = acGoto(f, c);
+                }
+                f = g < 0 ? 0 : g;
+            }
+            fail[k] = f;
+
+            const size_t fk = static_cast<size_t>(lbsSucc_.rank1(f) - 1);
+            out[k] = (f != 0 && isLeaf_.get(static_cast<size_t>(f))) ? f : out[fk];
+        }
+        ++k;
+    }
+
+    acFail_ = std::move(fail);
+    acOut_ = std::move(out);
+    acDepth_ = std::move(depth);
+}
+
+size_t LOUDSWithTermIdReaderUtf16::findAllMatches(std::u16string_view text, std::vector<Match> &out) const
+{
+    if (!hasAhoCorasick())
+        throw std::runtime_error("LOUDSWithTermIdReaderUtf16: enableAhoCorasick() was not called");
+    out.clear();
+
+    int state = 0;
+    for (size_t j = 0; j < text.size(); ++j)
+    {
+        const char16_t c = text[j];
+        int next = acGoto(state, c);
+        while (next < 0 && state != 0)
+        {
+            state = acFail_[static_cast<size_t>(lbsSucc_.rank1(state) - 1)];
+            next = acGoto(state, c);
+        }
+        state = next < 0 ? 0 : next;
+        if (state == 0)
+            continue;
+
+        const uint32_t end = static_cast<uint32_t>(j + 1);
+        int t = isLeaf_.get(static_cast<size_t>(state)) ? state : acOut_[static_cast<size_t>(lbsSucc_.rank1(state) - 1)];
+        while (t >= 0)
+        {
+            const size_t tk = static_cast<size_t>(lbsSucc_.rank1(t) - 1);
+            out.push_back(Match{end - acDepth_[tk], acDepth_[tk], termIdAt(t)});
+            t = acOut_[tk];
+        }
+    }
+    return out.size();
 }
@@ -2,47 +2,230 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include "common/alphabet_labels_utf16.hpp"
+#include "common/label_ops_utf16.hpp"
+#include "common/mapped_file_utf16.hpp"
+#include "common/prefix_hit_utf16.hpp"
+#include "common/root_dispatch_utf16.hpp"
+#include "common/succinct_bit_vector_utf16.hpp"
 #include "louds_with_term_id_utf16.hpp"
 
 // Reader for LOUDSWithTermIdUtf16.
 //
 // IMPORTANT (this repo's binary layout):
 // - labels are indexed by rank1(position) and there are TWO dummy labels at indices 0 and 1.
-// - termIdByNodeId.size() == popcount(1) of LBS (i.e., number of non-root nodes / edges).
+// - termIdByNodeId.size() == popcount(1) of LBS (i.e., number of non-root nodes / edges),
+//   or 0 in leaf-rank mode, where termId = rank1(isLeaf, pos) - 1.
 // - Therefore, nodeId index for a node-position "pos" (where LBS[pos] == 1) is:
 //       nodeId = rank1(pos) - 2
 //   (because rank1(pos) itself is the label index, and real labels start at index 2)
+//
+// The reader works on views: into a LOUDSWithTermIdUtf16 that must outlive it,
+// into a copy it owns (loadFromFile), or into a file mapped by mapFromFile (which
+// keeps the mapping alive). Files with 8-bit labels (FileSections::kLabels8)
+// are searched on the codes directly. One reader serves CPS, exact lookup and termIds, so
+// yomi_termid.louds only needs to be resident once.
 class LOUDSWithTermIdReaderUtf16
 {
 public:
+    // One hit of commonPrefixSearch: key[0, length) is a terminal node of the trie.
+    using PrefixHit = PrefixHitUtf16;
+
     explicit LOUDSWithTermIdReaderUtf16(const LOUDSWithTermIdUtf16 &trie);
 
+    // Zero-copy reader over yomi_termid.louds in the 8-byte aligned layout
+    // written by LOUDSWithTermIdUtf16::saveToFile (labels padded to a multiple
+    // of 4). Older files fall back to loadFromFile (a copy).
+    static LOUDSWithTermIdReaderUtf16 mapFromFile(const std::string &path);
+
+    // Reads the file into memory owned by the returned reader.
+    static LOUDSWithTermIdReaderUtf16 loadFromFile(const std::string &path);
+
+    // Opt-in: builds a RootDispatchUtf16 table so every lookup takes its first
+    // one or two steps from the root by table lookup instead of rank/select.
+    void enableRootDispatch();
+
     int firstChild(int pos) const;
     int traverse(int pos, char16_t c) const;
 
     int32_t getTermId(const std::u16string &key) const;
     std::pair<size_t, int32_t> longestPrefixTermId(const std::u16string &key) const;
 
+    // Common-prefix search fused with the termId lookup: walks key once from the
+    // root and appends a PrefixHit (shortest first) for every terminal node on the
+    // path, the same hits LOUDSReaderUtf16::commonPrefixSearch returns, without
+    // building strings. out is cleared first; reuse it across calls to avoid
+    // reallocating. Returns out.size().
+    size_t commonPrefixSearch(std::u16string_view key, std::vector<PrefixHit> &out) const;
+
+    // Same result as LOUDSReaderUtf16::commonPrefixSearch (matched prefixes, shortest first).
+    std::vector<std::u16string> commonPrefixSearch(const std::u16string &str) const;
+
+    // One hit of a predictive search: a key that starts with the query prefix.
+    // cost is the lowest word cost of the key (LOUDSWithTermIdUtf16::kNoCost
+    // when the trie has no predictive-search costs).
+    struct PredictiveHit
+    {
+        std::u16string key;
+        int32_t termId;
+        int16_t cost;
+    };
+
+    // Whether the trie carries the kPredictCosts section that predictTopK needs.
+    bool hasPredictCosts() const { return !subtreeMinCost_.empty(); }
+
+    // Keys that extend prefix (prefix itself included), in BFS order (shorter
+    // first, then by label), at most limit of them. out is cleared first.
+    size_t predictiveSearch(std::u16string_view prefix, size_t limit, std::vector<PredictiveHit> &out) const;
+
+    // The k keys under prefix with the lowest word cost, best first (ties in
+    // BFS order). Best-first over the subtree using the persisted per-subtree
+    // minimum cost, so only subtrees that can still beat the k-th result are
+    // expanded. Throws if the trie has no predictive-search costs.
+    size_t predictTopK(std::u16string_view prefix, size_t k, std::vector<PredictiveHit> &out) const;
+
+    // The key spelled from the root down to the node at pos.
+    std::u16string keyOf(int pos) const;
+
+    // Edit costs for fuzzyCommonPrefixSearch. A path is pruned as soon as its
+    // cost exceeds maxCost. The default budget only admits kana-family
+    // substitutions, which are looked up directly (a few traverses per
+    // character); a budget that admits general edits scans every child along
+    // the path and returns far more hits.
+    struct FuzzyOptions
+    {
+        uint16_t maxCost = 1;
+        uint16_t similarCost = 1;    // substitution within a kana family: dakuten/handakuten, small kana (か/が, つ/っ)
+        uint16_t substituteCost = 2; // any other substitution
+        uint16_t insertCost = 2;     // the key has a character the input lacks
+        uint16_t deleteCost = 2;     // the input has a character the key lacks
+    };
+
+    // One hit of fuzzyCommonPrefixSearch: input[0, length) matches the key of
+    // the terminal node pos (see keyOf) with edit cost cost.
+    struct FuzzyHit
+    {
+        uint32_t length;
+        int32_t termId;
+        uint16_t cost;
+        int32_t pos;
+    };
+
+    // Approximate common-prefix search: every key whose weighted edit distance
+    // to some prefix of input is at most opt.maxCost. Walks the trie as a
+    // Levenshtein automaton (state = node, input position, cost so far), so
+    // only subtrees reachable within the budget are visited; with no budget
+    // left a path continues by exact traverse only. Exact hits are included
+    // with cost 0. out is cleared first and holds one hit per (length, termId)
+    // with the lowest cost, sorted by length then cost. Returns out.size().
+    size_t fuzzyCommonPrefixSearch(std::u16string_view input, const FuzzyOptions &opt, std::vector<FuzzyHit> &out) const;
+
+    // Opt-in: derives Aho-Corasick failure and output links from the LOUDS
+    // (one BFS pass at load time, 10 bytes per node) so that findAllMatches
+    // reports every dictionary match of a text in one left-to-right pass.
+    void enableAhoCorasick();
+    bool hasAhoCorasick() const { return !acFail_.empty(); }
+
+    // One occurrence of a key in a text: text[start, start + length) is the key of termId.
+    struct Match
+    {
+        uint32_t start;
+        uint32_t length;
+        int32_t termId;
+    };
+
+    // Every key occurring in text: the hits commonPrefixSearch returns for
+    // each suffix text.substr(start), found with O(text.size()) transitions
+    // (amortized) plus one per match instead of a walk from every position.
+    // Matches come out by end position, longest first for the same end.
+    // out is cleared first. Requires enableAhoCorasick(). Returns out.size().
+    size_t findAllMatches(std::u16string_view text, std::vector<Match> &out) const;
+
 private:
     // Convert LOUDS position (a 1-bit position returned by traverse) to nodeId index for termIdByNodeId_.
     // Returns -1 if pos is root/invalid.
     int nodeIdFromPos(int pos) const;
 
-    // 1-indexed select0: returns the position of the k-th 0 bit in LBS.
-    // Returns -1 if k is out of range.
-    int select0_1indexed(int k) const;
+    // Node reached from pos (the node for key[0, i)) by key[i]; uses
+    // rootDispatch_ for i < 2 when enabled.
+    int step(int pos, std::u16string_view key, size_t i) const;
+
+    // termId of the node at LBS position pos (-1 if not terminal), from
+    // termIdByNodeId_ or, in leaf-rank mode, from rank1 on isLeaf.
+    int32_t termIdAt(int pos) const;
+
+    // Label at index i (rank1 of its LBS position), from labels_ or labels8_.
+    char16_t labelAt(size_t i) const;
+    size_t labelCount() const;
+
+    // Aho-Corasick goto: traverse, with rootDispatch_ for the root.
+    int acGoto(int pos, char16_t c) const;
+
+    // Index of c in the sibling labels [first, first + n), or -1.
+    // With labels8_, c's code is looked up here, once per step. The load hits
+    // the cached table while the step's rank/select is pending. Translating
+    // the whole key before the walk measured slower, because most walks stop
+    // after a few characters (see AlphabetLabelsUtf16).
+    int findLabel(size_t first, size_t n, char16_t c) const;
+
+    // Node reached by walking the whole of prefix from the root, or -1.
+    int nodeFor(std::u16string_view prefix) const;
+
+    void fuzzyWalk(int pos, size_t i, uint16_t cost, std::u16string_view input,
+                   const FuzzyOptions &opt, std::vector<FuzzyHit> &out) const;
+
+    // Sets up labels8_ from a kLabels8 section (no-op when absent).
+    void initLabels8(std::optional<std::span<const uint8_t>> section);
+
+    // Adopts the predictive-search costs and makes sure isLeafSucc_ can rank.
+    void initPredictCosts(std::span<const int16_t> subtreeMin, std::span<const int16_t> leafMin);
 
 private:
-    const BitVector &LBS_;
-    const BitVector &isLeaf_;
-    const std::vector<char16_t> &labels_;
-    const std::vector<int32_t> &termIdByNodeId_;
-
-    // Precomputed 0-bit positions for select0 (1-indexed):
-    // zeroPos_[k] = position of k-th 0 in LBS, zeroPos_[0] is dummy.
-    std::vector<int> zeroPos_;
+    LOUDSWithTermIdReaderUtf16() = default;
+
+    std::shared_ptr<const MappedFile> map_;              // null unless mapFromFile
+    std::shared_ptr<const LOUDSWithTermIdUtf16> owned_; // null unless loadFromFile
+
+    BitVectorView LBS_;
+    BitVectorView isLeaf_;
+    std::span<const char16_t> labels_; // empty when labels8_ is used
+    std::span<const int32_t> termIdByNodeId_;
+
+    // rank/select over LBS. Adopts the persisted index (trie.LBSIndex, or the
+    // section in the mapped file) when present, otherwise the directory is built here.
+    SuccinctBitVector lbsSucc_;
+
+    // Leaf-rank mode (FileSections::kLeafRankTermIds): termIdByNodeId_ is empty
+    // and isLeafSucc_ (rank only) supplies the termIds. isLeafSucc_ is also
+    // built when the predictive-search costs are present.
+    bool leafRank_{false};
+    SuccinctBitVector isLeafSucc_;
+
+    // Predictive-search costs (see LOUDSWithTermIdUtf16::subtreeMinCost);
+    // empty when the trie has none.
+    std::span<const int16_t> subtreeMinCost_;
+    std::span<const int16_t> leafMinCost_;
+
+    // 8-bit labels; empty unless the trie has a kLabels8 section.
+    AlphabetLabelsUtf16 labels8_;
+
+    // Aho-Corasick links, indexed by node k = rank1(LBS, pos) - 1 (root = 0);
+    // empty unless enableAhoCorasick() was called.
+    // - acFail_[k]: LBS position of the longest proper suffix of node k's key that is a node
+    // - acOut_[k]: LBS position of the longest proper suffix that is a terminal node, or -1
+    // - acDepth_[k]: length of node k's key
+    std::vector<int32_t> acFail_;
+    std::vector<int32_t> acOut_;
+    std::vector<uint16_t> acDepth_;
+
+    // Empty unless enableRootDispatch() was called.
+    RootDispatchUtf16 rootDispatch_;
 };
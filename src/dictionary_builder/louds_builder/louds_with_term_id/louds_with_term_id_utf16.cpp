@@ -1,5 +1,11 @@
 #include "louds_with_term_id/louds_with_term_id_utf16.hpp"
 
+#include <algorithm>
+#include <cstring>
+
+#include "common/alphabet_labels_utf16.hpp"
+#include "common/succinct_bit_vector_utf16.hpp"
+
 LOUDSWithTermIdUtf16::LOUDSWithTermIdUtf16()
 {
     // Keep compatibility with the existing LOUDSUtf16 dummy root behavior.
@@ -28,6 +34,117 @@ void LOUDSWithTermIdUtf16::convertListToBitVector()
     termIdByNodeIdTemp.clear();
 }
 
+bool LOUDSWithTermIdUtf16::useLeafRankTermIds()
+{
+    if (termIdsByLeafRank)
+        return true;
+
+    // nodeId of the node at a 1-bit is the number of 1s before it (root = 0).
+    size_t nodeId = 0;
+    int32_t leafRank = 0;
+    for (size_t pos = 0; pos < LBS.size(); ++pos)
+    {
+        if (!LBS.get(pos))
+            continue;
+        if (nodeId >= termIdByNodeId.size())
+            return false;
+
+        const int32_t expected = isLeaf.get(pos) ? leafRank++ : -1;
+        if (termIdByNodeId[nodeId] != expected)
+            return false;
+        ++nodeId;
+    }
+    if (nodeId != termIdByNodeId.size())
+        return false;
+
+    termIdByNodeId.clear();
+    termIdByNodeId.shrink_to_fit();
+    termIdsByLeafRank = true;
+    return true;
+}
+
+void LOUDSWithTermIdUtf16::useAlphabetLabels()
+{
+    if (!labels8.empty())
+        return;
+    labels8 = AlphabetLabelsUtf16::encode(labels);
+    labels.clear();
+    labels.shrink_to_fit();
+}
+
+void LOUDSWithTermIdUtf16::setWordCosts(std::span<const int16_t> minCostByTermId)
+{
+    // Node k is the k-th 1 of LBS (root = 0); its parent is the node whose
+    // 0-terminated child run contains it, i.e. node (number of 0s before it) - 1.
+    std::vector<int32_t> parent;
+    std::vector<int16_t> subtree;
+    std::vector<int16_t> leaf;
+    size_t zeros = 0;
+    size_t leafRank = 0;
+    for (size_t pos = 0; pos < LBS.size(); ++pos)
+    {
+        if (!LBS.get(pos))
+        {
+            ++zeros;
+            continue;
+        }
+
+        const size_t k = parent.size();
+        parent.push_back(static_cast<int32_t>(zeros) - 1);
+
+        int16_t own = kNoCost;
+        if (isLeaf.get(pos))
+        {
+            const int32_t termId = termIdsByLeafRank ? static_cast<int32_t>(leafRank)
+                                   : k < termIdByNodeId.size() ? termIdByNodeId[k]
+                                                               : -1;
+            if (termId >= 0 && static_cast<size_t>(termId) < minCostByTermId.size())
+                own = minCostByTermId[static_cast<size_t>(termId)];
+            leaf.push_back(own);
+            ++leafRank;
+        }
+        subtree.push_back(own);
+    }
+
+    // Children come after their parent in BFS order, so one backward pass
+    // folds every subtree into its parent.
+    for (size_t k = subtree.size(); k-- > 1;)
+    {
+        int16_t &up = subtree[static_cast<size_t>(parent[k])];
+        up = std::min(up, subtree[k]);
+    }
+
+    subtreeMinCost = std::move(subtree);
+    leafMinCost = std::move(leaf);
+}
+
+bool LOUDSWithTermIdUtf16::viewPredictCosts(std::span<const uint8_t> section,
+                                            BitVectorView lbs,
+                                            BitVectorView isLeaf,
+                                            std::span<const int16_t> &subtreeMin,
+                                            std::span<const int16_t> &leafMin)
+{
+    // u64 nodeN, i16 subtreeMin[nodeN] (padded to 4), u64 leafN, i16 leafMin[leafN] (padded to 4)
+    size_t p = 0;
+    const auto take = [&](std::span<const int16_t> &out) -> bool
+    {
+        uint64_t n = 0;
+        if (section.size() - p < sizeof(n))
+            return false;
+        std::memcpy(&n, section.data() + p, sizeof(n));
+        p += sizeof(n);
+        const uint64_t bytes = ((n + 3) & ~uint64_t{3}) * sizeof(int16_t);
+        if (bytes > section.size() - p)
+            return false;
+        out = {reinterpret_cast<const int16_t *>(section.data() + p), static_cast<size_t>(n)};
+        p += static_cast<size_t>(bytes);
+        return true;
+    };
+    // predictTopK indexes them by rank1 without bounds checks
+    return take(subtreeMin) && take(leafMin) && subtreeMin.size() == lbs.countOnes() &&
+           leafMin.size() == isLeaf.countOnes();
+}
+
 void LOUDSWithTermIdUtf16::write_u64(std::ostream &os, uint64_t v)
 {
     os.write(reinterpret_cast<const char *>(&v), sizeof(v));
@@ -97,7 +214,7 @@ BitVector LOUDSWithTermIdUtf16::readBitVector(std::istream &is)
     return bv;
 }
 
-void LOUDSWithTermIdUtf16::saveToFile(const std::string &path) const
+void LOUDSWithTermIdUtf16::saveToFile(const std::string &path, bool withIndex) const
 {
     std::ofstream ofs(path, std::ios::binary);
     if (!ofs)
@@ -106,15 +223,50 @@ void LOUDSWithTermIdUtf16::saveToFile(const std::string &path) const
     writeBitVector(ofs, LBS);
     writeBitVector(ofs, isLeaf);
 
-    // labels
-    write_u64(ofs, static_cast<uint64_t>(labels.size()));
+    // labels: padded with dummy labels to a multiple of 4 so that everything
+    // after them stays 8-byte aligned for mapFromFile. rank1 never reaches the
+    // padding (at most labels.size() - 1), so older readers are unaffected.
+    // Empty when the labels are in the kLabels8 section.
+    const size_t labelN = (labels.size() + 3) & ~size_t{3};
+    write_u64(ofs, static_cast<uint64_t>(labelN));
     for (char16_t ch : labels)
         write_u16(ofs, static_cast<uint16_t>(ch));
+    for (size_t i = labels.size(); i < labelN; ++i)
+        write_u16(ofs, static_cast<uint16_t>(u' '));
 
-    // termIdByNodeId
+    // termIdByNodeId (empty when termIdsByLeafRank)
     write_u64(ofs, static_cast<uint64_t>(termIdByNodeId.size()));
     for (int32_t v : termIdByNodeId)
         write_i32(ofs, v);
+
+    FileSections sections;
+    if (withIndex)
+        sections.add(FileSections::kLbsIndex, SuccinctBitVector(LBS).serializeIndex());
+    if (termIdsByLeafRank)
+    {
+        // Only rank is needed on isLeaf, so no select hints.
+        sections.add(FileSections::kLeafRankTermIds,
+                     withIndex ? SuccinctBitVector(isLeaf, /*withSelectHints=*/false).serializeIndex()
+                               : std::vector<uint8_t>{});
+    }
+    if (!labels8.empty())
+        sections.add(FileSections::kLabels8, labels8);
+    if (!subtreeMinCost.empty())
+    {
+        std::vector<uint8_t> bytes;
+        for (const auto *v : {&subtreeMinCost, &leafMinCost})
+        {
+            const uint64_t n = static_cast<uint64_t>(v->size());
+            const auto *np = reinterpret_cast<const uint8_t *>(&n);
+            bytes.insert(bytes.end(), np, np + sizeof(n));
+            const auto *vp = reinterpret_cast<const uint8_t *>(v->data());
+            bytes.insert(bytes.end(), vp, vp + v->size() * sizeof(int16_t));
+            bytes.resize((bytes.size() + 7) & ~size_t{7}, 0);
+        }
+        sections.add(FileSections::kPredictCosts, std::move(bytes));
+    }
+    if (!sections.empty())
+        sections.write(ofs);
 }
 
 LOUDSWithTermIdUtf16 LOUDSWithTermIdUtf16::loadFromFile(const std::string &path)
@@ -146,5 +298,25 @@ LOUDSWithTermIdUtf16 LOUDSWithTermIdUtf16::loadFromFile(const std::string &path)
         read_i32(ifs, v);
         l.termIdByNodeId[i] = v;
     }
+
+    const FileSections sections = FileSections::read(ifs);
+    if (const auto *idx = sections.find(FileSections::kLbsIndex))
+        l.LBSIndex = *idx;
+    if (const auto *idx = sections.find(FileSections::kLeafRankTermIds))
+    {
+        l.termIdsByLeafRank = true;
+        l.isLeafIndex = *idx;
+    }
+    if (const auto *bytes = sections.find(FileSections::kLabels8))
+        l.labels8 = *bytes;
+    if (const auto *bytes = sections.find(FileSections::kPredictCosts))
+    {
+        std::span<const int16_t> subtreeMin;
+        std::span<const int16_t> leafMin;
+        if (!viewPredictCosts(*bytes, BitVectorView(l.LBS), BitVectorView(l.isLeaf), subtreeMin, leafMin))
+            throw std::runtime_error("malformed predictive-search costs: " + path);
+        l.subtreeMinCost.assign(subtreeMin.begin(), subtreeMin.end());
+        l.leafMinCost.assign(leafMin.begin(), leafMin.end());
+    }
     return l;
 }
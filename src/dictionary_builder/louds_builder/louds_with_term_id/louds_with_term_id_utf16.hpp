@@ -4,16 +4,19 @@
 #include <fstream>
 #include <istream>
 #include <ostream>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "common/bit_vector_utf16.hpp"
+#include "common/file_sections_utf16.hpp"
 
 // LOUDS trie (UTF-16) with an additional "termId" per node.
 //
 // termIdByNodeId_ is indexed by nodeId (rank0 in LBS), and stores the
 // application-defined terminal id for that node (or -1 if not terminal).
+// It can be dropped when termIds follow the leaf order (see useLeafRankTermIds).
 
 class LOUDSWithTermIdUtf16
 {
@@ -33,11 +36,62 @@ public:
     // Final termId mapping aligned with nodeId (rank0).
     std::vector<int32_t> termIdByNodeId;
 
+    // Persisted SuccinctBitVector index of LBS as read from the file
+    // (FileSections::kLbsIndex). Empty when the file has none.
+    std::vector<uint8_t> LBSIndex;
+
+    // When true, termIdByNodeId is empty and the termId of a terminal node at
+    // LBS position pos is rank1(isLeaf, pos) - 1 (FileSections::kLeafRankTermIds).
+    bool termIdsByLeafRank = false;
+
+    // Persisted SuccinctBitVector index of isLeaf (only with termIdsByLeafRank).
+    // Empty when the file has none.
+    std::vector<uint8_t> isLeafIndex;
+
+    // When non-empty, labels is empty and the labels are stored here as an
+    // AlphabetLabelsUtf16 section (FileSections::kLabels8).
+    std::vector<uint8_t> labels8;
+
+    // Minimum word costs for predictive search (FileSections::kPredictCosts).
+    // Empty unless setWordCosts was called or the file has the section.
+    // - subtreeMinCost[k]: lowest cost of any word in the subtree of node k
+    //   (k = rank1(LBS, pos) - 1, root = 0), kNoCost if the subtree has none.
+    // - leafMinCost[j]: cost of the word ending at the j-th terminal node
+    //   (j = rank1(isLeaf, pos) - 1).
+    static constexpr int16_t kNoCost = INT16_MAX;
+    std::vector<int16_t> subtreeMinCost;
+    std::vector<int16_t> leafMinCost;
+
     LOUDSWithTermIdUtf16();
 
     void convertListToBitVector();
 
-    void saveToFile(const std::string &path) const;
+    // Switches to termIdsByLeafRank if every terminal node's termId equals its
+    // rank among terminal nodes in BFS order, which is what termIds assigned in
+    // (length asc, lex asc) order give. Otherwise returns false and leaves the
+    // trie unchanged.
+    bool useLeafRankTermIds();
+
+    // Re-encodes labels as 8-bit alphabet codes (see AlphabetLabelsUtf16) and
+    // clears labels. Readers built before kLabels8 cannot read such a file.
+    void useAlphabetLabels();
+
+    // Fills subtreeMinCost/leafMinCost from minCostByTermId[termId], the lowest
+    // wordCost among the tokens of termId (what TokenArray holds for it).
+    void setWordCosts(std::span<const int16_t> minCostByTermId);
+
+    // Views the two arrays of a kPredictCosts section in place (8-byte aligned).
+    // Returns false if the section is malformed or its arrays do not have one
+    // entry per node (ones of lbs) and per terminal node (ones of isLeaf).
+    static bool viewPredictCosts(std::span<const uint8_t> section,
+                                 BitVectorView lbs,
+                                 BitVectorView isLeaf,
+                                 std::span<const int16_t> &subtreeMin,
+                                 std::span<const int16_t> &leafMin);
+
+    // withIndex: append the precomputed LBS rank/select index as a FileSections
+    // section so readers can adopt it instead of rebuilding it.
+    void saveToFile(const std::string &path, bool withIndex = false) const;
     static LOUDSWithTermIdUtf16 loadFromFile(const std::string &path);
 
 private:
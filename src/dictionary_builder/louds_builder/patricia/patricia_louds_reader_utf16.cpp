@@ -0,0 +1,215 @@
+#include "patricia/patricia_louds_reader_utf16.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+PatriciaLOUDSReaderUtf16::PatriciaLOUDSReaderUtf16(const PatriciaLOUDSUtf16 &trie)
+    : LBS_(trie.LBS),
+      isLeaf_(trie.isLeaf),
+      hasTail_(trie.hasTail),
+      labels_(trie.labels),
+      tailOffsets_(trie.tailOffsets),
+      tailPool_(trie.tailPool),
+      termIds_(trie.termIds)
+{
+    initIndexes(trie.LBSIndex.empty() ? std::nullopt : std::optional(std::span<const uint8_t>(trie.LBSIndex)));
+}
+
+void PatriciaLOUDSReaderUtf16::initIndexes(std::optional<std::span<const uint8_t>> lbsIndex)
+{
+    lbsSucc_ = SuccinctBitVector::adoptView(LBS_, lbsIndex);
+    isLeafSucc_ = SuccinctBitVector::adoptView(isLeaf_, std::nullopt, /*withSelectHints=*/false);
+    hasTailSucc_ = SuccinctBitVector::adoptView(hasTail_, std::nullopt, /*withSelectHints=*/false);
+    if (tailOffsets_.empty())
+        throw std::runtime_error("PatriciaLOUDSReaderUtf16: missing tail offsets");
+}
+
+PatriciaLOUDSReaderUtf16 PatriciaLOUDSReaderUtf16::mapFromFile(const std::string &path)
+{
+    PatriciaLOUDSReaderUtf16 r;
+    r.map_ = MappedFile::open(path);
+
+    MappedReader in(r.map_->data(), r.map_->size(), "PatriciaLOUDSReaderUtf16: " + path);
+    if (in.remaining() < sizeof(uint64_t) || in.u64() != PatriciaLOUDSUtf16::kMagic)
+        in.fail("not a Patricia LOUDS file");
+    r.LBS_ = in.bits();
+    r.isLeaf_ = in.bits();
+    r.hasTail_ = in.bits();
+    r.labels_ = in.array<char16_t>(static_cast<size_t>(in.u64()));
+    r.tailOffsets_ = in.array<uint32_t>(static_cast<size_t>(in.u64()));
+    r.tailPool_ = in.array<char16_t>(static_cast<size_t>(in.u64()));
+    r.termIds_ = in.array<int32_t>(static_cast<size_t>(in.u64()));
+
+    r.initIndexes(FileSections::locate(r.map_->data(), r.map_->size(), FileSections::kLbsIndex));
+    return r;
+}
+
+PatriciaLOUDSReaderUtf16 PatriciaLOUDSReaderUtf16::loadFromFile(const std::string &path)
+{
+    // Heap-allocated so the views stay valid when the reader is moved.
+    auto trie = std::make_shared<const PatriciaLOUDSUtf16>(PatriciaLOUDSUtf16::loadFromFile(path));
+    PatriciaLOUDSReaderUtf16 r(*trie);
+    r.owned_ = std::move(trie);
+    return r;
+}
+
+int PatriciaLOUDSReaderUtf16::firstChild(int pos) const
+{
+    const int z = lbsSucc_.select0(lbsSucc_.rank1(pos));
+    if (z < 0)
+        return -1;
+    return z + 1;
+}
+
+std::u16string_view PatriciaLOUDSReaderUtf16::tailOf(int pos) const
+{
+    if (!hasTail_.get(static_cast<size_t>(pos)))
+        return {};
+    const size_t j = static_cast<size_t>(hasTailSucc_.rank1(pos) - 1);
+    if (j + 1 >= tailOffsets_.size())
+        return {};
+    const size_t b = tailOffsets_[j];
+    const size_t e = std::min<size_t>(tailOffsets_[j + 1], tailPool_.size());
+    if (b >= e)
+        return {};
+    return std::u16string_view(tailPool_.data() + b, e - b);
+}
+
+int PatriciaLOUDSReaderUtf16::descend(int pos, std::u16string_view key, size_t &i) const
+{
+    const int childPos = firstChild(pos);
+    if (childPos < 0)
+        return -1;
+
+    const size_t fanout = LBS_.onesRun(static_cast<size_t>(childPos));
+    const int k = labelops::findSorted(labels_, static_cast<size_t>(lbsSucc_.rank1(childPos)), fanout, key[i]);
+    if (k < 0)
+        return -1;
+
+    const int child = childPos + k;
+    const std::u16string_view tail = tailOf(child);
+    if (key.size() - (i + 1) < tail.size() || key.substr(i + 1, tail.size()) != tail)
+        return -1;
+
+    i += 1 + tail.size();
+    return child;
+}
+
+int32_t PatriciaLOUDSReaderUtf16::termIdAt(int pos) const
+{
+    if (!isLeaf_.get(static_cast<size_t>(pos)))
+        return -1;
+    const int j = isLeafSucc_.rank1(pos) - 1;
+    if (j < 0 || static_cast<size_t>(j) >= termIds_.size())
+        return -1;
+    return termIds_[static_cast<size_t>(j)];
+}
+
+int32_t PatriciaLOUDSReaderUtf16::getTermId(const std::u16string &key) const
+{
+    int pos = 0; // root
+    size_t i = 0;
+    while (i < key.size())
+    {
+        pos = descend(pos, key, i);
+        if (pos < 0)
+            return -1;
+    }
+    return key.empty() ? -1 : termIdAt(pos);
+}
+
+std::pair<size_t, int32_t> PatriciaLOUDSReaderUtf16::longestPrefixTermId(const std::u16string &key) const
+{
+    size_t bestLen = 0;
+    int32_t bestTermId = -1;
+
+    int pos = 0;
+    size_t i = 0;
+    while (i < key.size())
+    {
+        pos = descend(pos, key, i);
+        if (pos < 0)
+            break;
+
+        const int32_t termId = termIdAt(pos);
+        if (termId >= 0)
+        {
+            bestLen = i;
+            bestTermId = termId;
+        }
+    }
+    return {bestLen, bestTermId};
+}
+
+size_t PatriciaLOUDSReaderUtf16::commonPrefixSearch(std::u16string_view key, std::vector<PrefixHit> &out) const
+{
+    out.clear();
+
+    int pos = 0;
+    size_t i = 0;
+    while (i < key.size())
+    {
+        pos = descend(pos, key, i);
+        if (pos < 0)
+            break;
+
+        if (isLeaf_.get(static_cast<size_t>(pos)))
+            out.push_back(PrefixHit{static_cast<uint32_t>(i), termIdAt(pos)});
+    }
+    return out.size();
+}
+
+std::vector<std::u16string> PatriciaLOUDSReaderUtf16::commonPrefixSearch(const std::u16string &str) const
+{
+    std::vector<PrefixHit> hits;
+    commonPrefixSearch(str, hits);
+
+    std::vector<std::u16string> result;
+    result.reserve(hits.size());
+    for (const auto &hit : hits)
+        result.emplace_back(str, 0, hit.length);
+    return result;
+}
+
+int PatriciaLOUDSReaderUtf16::getNodeIndex(const std::u16string &s) const
+{
+    if (s.empty())
+        return -1;
+
+    int pos = 0;
+    size_t i = 0;
+    while (i < s.size())
+    {
+        pos = descend(pos, s, i);
+        if (pos < 0)
+            return -1;
+    }
+    return pos;
+}
+
+std::u16string PatriciaLOUDSReaderUtf16::getLetter(int nodeIndex) const
+{
+    if (nodeIndex <= 0 || static_cast<size_t>(nodeIndex) >= LBS_.size() ||
+        !LBS_.get(static_cast<size_t>(nodeIndex)))
+        return u"";
+
+    // Collect the edges bottom-up, each reversed, then reverse the whole.
+    std::u16string out;
+    int current = nodeIndex;
+    while (current > 0)
+    {
+        const int labelIndex = lbsSucc_.rank1(current);
+        if (labelIndex < 2 || static_cast<size_t>(labelIndex) >= labels_.size())
+            break;
+
+        const std::u16string_view tail = tailOf(current);
+        out.append(tail.rbegin(), tail.rend());
+        out.push_back(labels_[static_cast<size_t>(labelIndex)]);
+
+        // parent: the node whose 0-terminated child run contains current
+        current = lbsSucc_.select1(lbsSucc_.rank0(current));
+    }
+
+    std::reverse(out.begin(), out.end());
+    return out;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common/file_sections_utf16.hpp"
+#include "common/label_ops_utf16.hpp"
+#include "common/mapped_file_utf16.hpp"
+#include "common/prefix_hit_utf16.hpp"
+#include "common/succinct_bit_vector_utf16.hpp"
+#include "patricia_louds_utf16.hpp"
+
+// Reader for PatriciaLOUDSUtf16 (.plouds), with the lookups of
+// LOUDSWithTermIdReaderUtf16 (fused common-prefix search, termId, longest
+// prefix) plus getNodeIndex/getLetter of LOUDSReaderUtf16.
+//
+// One step matches a whole edge: the first code unit through the sorted
+// sibling run (one rank1 + select0 as in the plain reader), the tail by a
+// direct compare against tailPool, so a unary chain costs one rank on hasTail
+// instead of a rank/select round trip per code unit.
+//
+// Like the other readers it works on views: into a PatriciaLOUDSUtf16 that must
+// outlive it, into a copy it owns (loadFromFile), or into a file mapped by
+// mapFromFile (which keeps the mapping alive).
+class PatriciaLOUDSReaderUtf16
+{
+public:
+    using PrefixHit = PrefixHitUtf16;
+
+    explicit PatriciaLOUDSReaderUtf16(const PatriciaLOUDSUtf16 &trie);
+
+    static PatriciaLOUDSReaderUtf16 mapFromFile(const std::string &path);
+    static PatriciaLOUDSReaderUtf16 loadFromFile(const std::string &path);
+
+    int32_t getTermId(const std::u16string &key) const;
+    std::pair<size_t, int32_t> longestPrefixTermId(const std::u16string &key) const;
+
+    // Same contract as LOUDSWithTermIdReaderUtf16::commonPrefixSearch.
+    size_t commonPrefixSearch(std::u16string_view key, std::vector<PrefixHit> &out) const;
+    std::vector<std::u16string> commonPrefixSearch(const std::u16string &str) const;
+
+    // LBS position of the node spelling s exactly, or -1 (also when s ends
+    // inside an edge, where there is no node).
+    int getNodeIndex(const std::u16string &s) const;
+
+    // The key spelled from the root down to the node at nodeIndex.
+    std::u16string getLetter(int nodeIndex) const;
+
+    // Number of nodes, root excluded.
+    size_t nodeCount() const { return static_cast<size_t>(lbsSucc_.totalOnes()) - 1; }
+
+private:
+    PatriciaLOUDSReaderUtf16() = default;
+
+    // Builds the rank/select directories not taken from the file (isLeaf and
+    // hasTail are rank-only and cheap to build).
+    void initIndexes(std::optional<std::span<const uint8_t>> lbsIndex);
+
+    int firstChild(int pos) const;
+
+    // Follows the edge of node pos that spells key[i, ...). On success returns
+    // the child position and advances i past the edge; -1 if no edge matches
+    // in full.
+    int descend(int pos, std::u16string_view key, size_t &i) const;
+
+    // Tail of the edge above the node at pos (what follows labels[rank1(pos)]).
+    std::u16string_view tailOf(int pos) const;
+
+    int32_t termIdAt(int pos) const;
+
+    std::shared_ptr<const MappedFile> map_;             // null unless mapFromFile
+    std::shared_ptr<const PatriciaLOUDSUtf16> owned_; // null unless loadFromFile
+
+    BitVectorView LBS_;
+    BitVectorView isLeaf_;
+    BitVectorView hasTail_;
+    std::span<const char16_t> labels_;
+    std::span<const uint32_t> tailOffsets_;
+    std::span<const char16_t> tailPool_;
+    std::span<const int32_t> termIds_;
+
+    SuccinctBitVector lbsSucc_;
+    SuccinctBitVector isLeafSucc_;  // rank only
+    SuccinctBitVector hasTailSucc_; // rank only
+};
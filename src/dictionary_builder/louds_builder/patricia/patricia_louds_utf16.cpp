@@ -0,0 +1,184 @@
+#include "patricia/patricia_louds_utf16.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+#include "common/file_sections_utf16.hpp"
+#include "common/succinct_bit_vector_utf16.hpp"
+
+PatriciaLOUDSUtf16 PatriciaLOUDSUtf16::convert(const PrefixNodeWithTermIdUtf16 *rootNode)
+{
+    PatriciaLOUDSUtf16 p;
+
+    // Dummy root, as in LOUDSWithTermIdUtf16.
+    std::vector<bool> lbs = {true, false};
+    std::vector<bool> leaf = {false, false};
+    std::vector<bool> tail = {false, false};
+    p.labels = {u' ', u' '};
+    p.tailOffsets = {0};
+
+    std::queue<const PrefixNodeWithTermIdUtf16 *> q;
+    q.push(rootNode);
+
+    while (!q.empty())
+    {
+        const PrefixNodeWithTermIdUtf16 *node = q.front();
+        q.pop();
+
+        if (node && node->hasChild())
+        {
+            std::vector<std::pair<char16_t, const PrefixNodeWithTermIdUtf16 *>> ordered;
+            ordered.reserve(node->children.size());
+            for (const auto &kv : node->children)
+                ordered.emplace_back(kv.first, kv.second.get());
+
+            std::sort(ordered.begin(), ordered.end(),
+                      [](const auto &a, const auto &b)
+                      { return a.first < b.first; });
+
+            for (const auto &kv : ordered)
+            {
+                // Follow the chain below the child while it neither ends a key
+                // nor branches; the code units passed become the edge's tail.
+                const PrefixNodeWithTermIdUtf16 *end = kv.second;
+                const size_t tailStart = p.tailPool.size();
+                while (!end->isWord && end->children.size() == 1)
+                {
+                    const auto &only = *end->children.begin();
+                    p.tailPool.push_back(only.first);
+                    end = only.second.get();
+                }
+
+                q.push(end);
+                lbs.push_back(true);
+                p.labels.push_back(kv.first);
+                leaf.push_back(end->isWord);
+                tail.push_back(p.tailPool.size() != tailStart);
+
+                if (p.tailPool.size() != tailStart)
+                    p.tailOffsets.push_back(static_cast<uint32_t>(p.tailPool.size()));
+                if (end->isWord)
+                    p.termIds.push_back(end->termId);
+            }
+        }
+
+        lbs.push_back(false);
+        leaf.push_back(false);
+        tail.push_back(false);
+    }
+
+    for (bool b : lbs)
+        p.LBS.push_back(b);
+    for (bool b : leaf)
+        p.isLeaf.push_back(b);
+    for (bool b : tail)
+        p.hasTail.push_back(b);
+    return p;
+}
+
+void PatriciaLOUDSUtf16::write_u64(std::ostream &os, uint64_t v)
+{
+    os.write(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+void PatriciaLOUDSUtf16::read_u64(std::istream &is, uint64_t &v)
+{
+    is.read(reinterpret_cast<char *>(&v), sizeof(v));
+}
+
+void PatriciaLOUDSUtf16::writeBitVector(std::ostream &os, const BitVector &bv)
+{
+    write_u64(os, static_cast<uint64_t>(bv.size()));
+    write_u64(os, static_cast<uint64_t>(bv.words().size()));
+    os.write(reinterpret_cast<const char *>(bv.words().data()),
+             static_cast<std::streamsize>(bv.words().size() * sizeof(uint64_t)));
+}
+
+BitVector PatriciaLOUDSUtf16::readBitVector(std::istream &is)
+{
+    uint64_t nbits = 0;
+    read_u64(is, nbits);
+    auto words = readArray<uint64_t>(is);
+    BitVector bv;
+    bv.assign_from_words(static_cast<size_t>(nbits), std::move(words));
+    return bv;
+}
+
+template <class T>
+void PatriciaLOUDSUtf16::writeArray(std::ostream &os, const std::vector<T> &v, size_t paddedN, T pad)
+{
+    write_u64(os, static_cast<uint64_t>(paddedN));
+    os.write(reinterpret_cast<const char *>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+    for (size_t i = v.size(); i < paddedN; ++i)
+        os.write(reinterpret_cast<const char *>(&pad), sizeof(T));
+}
+
+template <class T>
+std::vector<T> PatriciaLOUDSUtf16::readArray(std::istream &is)
+{
+    uint64_t n = 0;
+    read_u64(is, n);
+    std::vector<T> v(static_cast<size_t>(n));
+    if (n > 0)
+        is.read(reinterpret_cast<char *>(v.data()), static_cast<std::streamsize>(n * sizeof(T)));
+    return v;
+}
+
+void PatriciaLOUDSUtf16::saveToFile(const std::string &path, bool withIndex) const
+{
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs)
+        throw std::runtime_error("failed to open file for write: " + path);
+
+    write_u64(ofs, kMagic);
+    writeBitVector(ofs, LBS);
+    writeBitVector(ofs, isLeaf);
+    writeBitVector(ofs, hasTail);
+
+    // Pad every array so the next one starts 8-byte aligned.
+    writeArray(ofs, labels, (labels.size() + 3) & ~size_t{3}, u' ');
+    writeArray(ofs, tailOffsets, (tailOffsets.size() + 1) & ~size_t{1}, tailOffsets.back());
+    writeArray(ofs, tailPool, (tailPool.size() + 3) & ~size_t{3}, u' ');
+    writeArray(ofs, termIds, (termIds.size() + 1) & ~size_t{1}, int32_t{-1});
+
+    if (withIndex)
+    {
+        FileSections sections;
+        sections.add(FileSections::kLbsIndex, SuccinctBitVector(LBS).serializeIndex());
+        sections.write(ofs);
+    }
+
+    if (!ofs)
+        throw std::runtime_error("failed to write file: " + path);
+}
+
+PatriciaLOUDSUtf16 PatriciaLOUDSUtf16::loadFromFile(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("failed to open file for read: " + path);
+
+    uint64_t magic = 0;
+    read_u64(ifs, magic);
+    if (!ifs || magic != kMagic)
+        throw std::runtime_error("not a Patricia LOUDS file: " + path);
+
+    PatriciaLOUDSUtf16 p;
+    p.LBS = readBitVector(ifs);
+    p.isLeaf = readBitVector(ifs);
+    p.hasTail = readBitVector(ifs);
+    p.labels = readArray<char16_t>(ifs);
+    p.tailOffsets = readArray<uint32_t>(ifs);
+    p.tailPool = readArray<char16_t>(ifs);
+    p.termIds = readArray<int32_t>(ifs);
+    if (!ifs || p.tailOffsets.empty())
+        throw std::runtime_error("failed to read file: " + path);
+
+    const FileSections sections = FileSections::read(ifs);
+    if (const auto *idx = sections.find(FileSections::kLbsIndex))
+        p.LBSIndex = *idx;
+    return p;
+}
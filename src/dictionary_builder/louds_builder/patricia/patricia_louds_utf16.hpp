@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common/bit_vector_utf16.hpp"
+#include "prefix_tree_with_term_id/prefix_tree_with_term_id_utf16.hpp"
+
+// Path-compressed (Patricia) LOUDS trie (UTF-16) with a termId per terminal node.
+//
+// Same LBS/isLeaf/labels layout as LOUDSWithTermIdUtf16 (dummy root "10", two
+// dummy labels, labels aligned with rank1), but an edge may spell more than one
+// code unit: a chain of non-terminal single-child nodes is collapsed into the
+// edge above it. The first code unit stays in labels (so siblings remain a
+// sorted run); the rest of the edge is the node's tail:
+//
+// - hasTail[pos] == 1 for a node at LBS position pos whose edge has a tail.
+// - the tail of the j-th such node (j = rank1(hasTail, pos) - 1) is
+//   tailPool[tailOffsets[j], tailOffsets[j + 1]).
+// - termIds[rank1(isLeaf, pos) - 1] is the termId of terminal node pos.
+//
+// Every key still ends exactly at a node, so termIds, and the node position
+// returned for a key (the nodeIndex getLetter reverses), keep their meaning.
+//
+// File layout (.plouds), everything 8-byte aligned for PatriciaLOUDSReaderUtf16::mapFromFile:
+//   u64 kMagic
+//   LBS, isLeaf, hasTail (BitVector: u64 nbits, u64 wordCount, u64 words[])
+//   u64 labelN,  u16 labels[labelN]        (padded to a multiple of 4)
+//   u64 offsetN, u32 tailOffsets[offsetN]  (padded to a multiple of 2)
+//   u64 poolN,   u16 tailPool[poolN]       (padded to a multiple of 4)
+//   u64 termN,   i32 termIds[termN]        (padded to a multiple of 2)
+//   optional FileSections (kLbsIndex)
+// Padding entries are never reached through the rank-based indexing.
+class PatriciaLOUDSUtf16
+{
+public:
+    static constexpr uint64_t kMagic = 0x3144554F4C504B4BULL; // "KKPLOUD1"
+
+    BitVector LBS;
+    BitVector isLeaf;
+    BitVector hasTail;
+    std::vector<char16_t> labels;
+    std::vector<uint32_t> tailOffsets;
+    std::vector<char16_t> tailPool;
+    std::vector<int32_t> termIds;
+
+    // Persisted SuccinctBitVector index of LBS (FileSections::kLbsIndex).
+    // Empty when the file has none.
+    std::vector<uint8_t> LBSIndex;
+
+    // BFS over the prefix tree with children sorted by label, like
+    // ConverterWithTermIdUtf16, collapsing unary non-terminal chains.
+    static PatriciaLOUDSUtf16 convert(const PrefixNodeWithTermIdUtf16 *rootNode);
+
+    // withIndex: append the LBS rank/select index as a FileSections section.
+    void saveToFile(const std::string &path, bool withIndex = false) const;
+    static PatriciaLOUDSUtf16 loadFromFile(const std::string &path);
+
+private:
+    static void write_u64(std::ostream &os, uint64_t v);
+    static void read_u64(std::istream &is, uint64_t &v);
+
+    static void writeBitVector(std::ostream &os, const BitVector &bv);
+    static BitVector readBitVector(std::istream &is);
+
+    template <class T>
+    static void writeArray(std::ostream &os, const std::vector<T> &v, size_t paddedN, T pad);
+    template <class T>
+    static std::vector<T> readArray(std::istream &is);
+};
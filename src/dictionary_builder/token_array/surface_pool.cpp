@@ -0,0 +1,212 @@
+#include "token_array/surface_pool.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    void write_u64(std::ostream &os, uint64_t v)
+    {
+        os.write(reinterpret_cast<const char *>(&v), sizeof(v));
+    }
+
+    void read_u64(std::istream &is, uint64_t &v)
+    {
+        is.read(reinterpret_cast<char *>(&v), sizeof(v));
+    }
+
+    // u64 n, T v[n], zero padding to 8 (same as TokenArray's v2 arrays)
+    template <class T>
+    void writeArray(std::ostream &os, std::span<const T> v)
+    {
+        static const char zeros[8] = {};
+        write_u64(os, static_cast<uint64_t>(v.size()));
+        if (!v.empty())
+            os.write(reinterpret_cast<const char *>(v.data()), static_cast<std::streamsize>(v.size_bytes()));
+        const size_t pad = (8 - (v.size_bytes() & 7)) & 7;
+        if (pad > 0)
+            os.write(zeros, static_cast<std::streamsize>(pad));
+    }
+
+    template <class T>
+    void readArray(std::istream &is, std::vector<T> &v)
+    {
+        uint64_t n = 0;
+        read_u64(is, n);
+        if (!is)
+            return;
+        v.resize(static_cast<size_t>(n));
+        if (n > 0)
+            is.read(reinterpret_cast<char *>(v.data()), static_cast<std::streamsize>(n * sizeof(T)));
+        const size_t pad = (8 - ((n * sizeof(T)) & 7)) & 7;
+        is.ignore(static_cast<std::streamsize>(pad));
+    }
+} // namespace
+
+SurfacePool SurfacePool::build(const std::vector<std::u16string> &sortedUnique, uint32_t bucketSize)
+{
+    if (bucketSize == 0 || bucketSize > kMaxBucketSize)
+        throw std::runtime_error("SurfacePool::build: bucketSize must be in [1, kMaxBucketSize]");
+
+    SurfacePool p;
+    p.count_ = sortedUnique.size();
+    p.bucketSize_ = bucketSize;
+
+    const auto push16 = [&](size_t v)
+    {
+        if (v > UINT16_MAX)
+            throw std::runtime_error("SurfacePool::build: surface too long");
+        p.dataStore_.push_back(static_cast<char16_t>(v));
+    };
+
+    for (size_t i = 0; i < sortedUnique.size(); ++i)
+    {
+        const std::u16string &s = sortedUnique[i];
+        if (i % bucketSize == 0)
+        {
+            if (p.dataStore_.size() > UINT32_MAX)
+                throw std::runtime_error("SurfacePool::build: pool too large");
+            p.offsetsStore_.push_back(static_cast<uint32_t>(p.dataStore_.size()));
+            push16(s.size());
+            p.dataStore_.insert(p.dataStore_.end(), s.begin(), s.end());
+            continue;
+        }
+
+        const std::u16string &prev = sortedUnique[i - 1];
+        if (!(prev < s))
+            throw std::runtime_error("SurfacePool::build: surfaces must be sorted and unique");
+        size_t lcp = 0;
+        while (lcp < prev.size() && lcp < s.size() && prev[lcp] == s[lcp])
+            ++lcp;
+        push16(lcp);
+        push16(s.size() - lcp);
+        p.dataStore_.insert(p.dataStore_.end(), s.begin() + static_cast<std::ptrdiff_t>(lcp), s.end());
+    }
+    if (p.dataStore_.size() > UINT32_MAX)
+        throw std::runtime_error("SurfacePool::build: pool too large");
+    p.offsetsStore_.push_back(static_cast<uint32_t>(p.dataStore_.size()));
+
+    p.offsets_ = p.offsetsStore_;
+    p.data_ = p.dataStore_;
+    return p;
+}
+
+void SurfacePool::validate(const std::string &what) const
+{
+    const uint64_t buckets = (count_ + bucketSize_ - 1) / bucketSize_;
+    if (offsets_.size() != buckets + 1 || offsets_.back() != data_.size())
+        throw std::runtime_error("SurfacePool: malformed pool: " + what);
+}
+
+void SurfacePool::get(uint32_t id, std::u16string &out) const
+{
+    struct Piece
+    {
+        size_t lcp;
+        const char16_t *chars;
+    };
+
+    // Forward over the headers only, noting where each entry's characters are.
+    const char16_t *p = data_.data() + offsets_[id / bucketSize_];
+    const uint32_t r = id % bucketSize_;
+    Piece pieces[kMaxBucketSize];
+    pieces[0] = Piece{0, p + 1};
+    size_t len = p[0];
+    p += 1 + len;
+    for (uint32_t k = 1; k <= r; ++k)
+    {
+        pieces[k] = Piece{p[0], p + 2};
+        len = static_cast<size_t>(p[0]) + p[1];
+        p += 2 + p[1];
+    }
+
+    // Fill from the back: each entry supplies the characters between its lcp
+    // and the prefix still missing, so every character is copied once.
+    out.resize(len);
+    size_t need = len;
+    for (uint32_t k = r + 1; need > 0 && k-- > 0;)
+    {
+        if (pieces[k].lcp < need)
+        {
+            std::copy(pieces[k].chars, pieces[k].chars + (need - pieces[k].lcp),
+                      out.begin() + static_cast<std::ptrdiff_t>(pieces[k].lcp));
+            need = pieces[k].lcp;
+        }
+    }
+}
+
+std::u16string SurfacePool::get(uint32_t id) const
+{
+    std::u16string out;
+    get(id, out);
+    return out;
+}
+
+void SurfacePool::saveToFile(const std::string &path) const
+{
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs)
+        throw std::runtime_error("failed to open file for write: " + path);
+
+    write_u64(ofs, kMagic);
+    write_u64(ofs, count_);
+    write_u64(ofs, bucketSize_);
+    writeArray(ofs, offsets_);
+    writeArray(ofs, data_);
+
+    if (!ofs)
+        throw std::runtime_error("failed to write file: " + path);
+}
+
+SurfacePool SurfacePool::loadFromFile(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("failed to open file for read: " + path);
+
+    uint64_t magic = 0;
+    read_u64(ifs, magic);
+    if (!ifs || magic != kMagic)
+        throw std::runtime_error("not a surface pool file: " + path);
+
+    SurfacePool p;
+    uint64_t bucketSize = 0;
+    read_u64(ifs, p.count_);
+    read_u64(ifs, bucketSize);
+    if (!ifs || bucketSize == 0 || bucketSize > kMaxBucketSize)
+        throw std::runtime_error("failed to read file: " + path);
+    p.bucketSize_ = static_cast<uint32_t>(bucketSize);
+
+    readArray(ifs, p.offsetsStore_);
+    readArray(ifs, p.dataStore_);
+    if (!ifs)
+        throw std::runtime_error("failed to read file: " + path);
+
+    p.offsets_ = p.offsetsStore_;
+    p.data_ = p.dataStore_;
+    p.validate(path);
+    return p;
+}
+
+SurfacePool SurfacePool::mapFromFile(const std::string &path)
+{
+    SurfacePool p;
+    p.map_ = MappedFile::open(path);
+
+    MappedReader in(p.map_->data(), p.map_->size(), "SurfacePool: " + path);
+    if (in.remaining() < sizeof(uint64_t) || in.u64() != kMagic)
+        in.fail("not a surface pool file");
+    p.count_ = in.u64();
+    const uint64_t bucketSize = in.u64();
+    if (bucketSize == 0 || bucketSize > kMaxBucketSize)
+        in.fail("bad bucket size");
+    p.bucketSize_ = static_cast<uint32_t>(bucketSize);
+
+    p.offsets_ = in.array<uint32_t>(static_cast<size_t>(in.u64()));
+    in.align(8);
+    p.data_ = in.array<char16_t>(static_cast<size_t>(in.u64()));
+
+    p.validate(path);
+    return p;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "./common/mapped_file_utf16.hpp"
+
+// SurfacePool stores the distinct tango surfaces as a front-coded string pool,
+// an alternative to rebuilding each candidate's surface from tango.louds with
+// getLetter (one rank/select climb per character).
+//
+// Surfaces are sorted and cut into buckets of bucketSize strings. The first
+// string of a bucket is stored whole; every later one as the length of the
+// prefix it shares with its predecessor plus the remaining suffix. A lookup
+// is one random access (the bucket offset) and a short sequential scan of at
+// most bucketSize - 1 entry headers; each character of the result is copied
+// once.
+//
+// The id of a surface is its index in sorted order. TokenArray keeps the id of
+// each token's surface (FileSections::kSurfaceIds in token_array.bin), so the
+// pool replaces the tango trie only for surface reconstruction; nodeIndex is
+// unchanged.
+//
+// tango_surfaces.bin (written by saveToFile):
+//   u64 kMagic
+//   u64 count, u64 bucketSize
+//   u64 n, u32 bucketOffsets[n], zero padding to 8   (n = buckets + 1, in code units)
+//   u64 n, u16 data[n],          zero padding to 8
+// with data per bucket:
+//   u16 len, u16 chars[len]                    (first string)
+//   { u16 lcp, u16 suffixLen, u16 chars[suffixLen] }*   (the others)
+// Every array starts 8-byte aligned, so mapFromFile can use them in place.
+class SurfacePool
+{
+public:
+    static constexpr uint64_t kMagic = 0x3150465255534B4BULL; // "KKSURFP1"
+    static constexpr uint32_t kDefaultBucketSize = 8;
+    static constexpr uint32_t kMaxBucketSize = 64; // get() keeps one bucket's entries on the stack
+
+    SurfacePool() = default;
+
+    // The views point into the vectors below, which survive a move but not a copy.
+    SurfacePool(const SurfacePool &) = delete;
+    SurfacePool &operator=(const SurfacePool &) = delete;
+    SurfacePool(SurfacePool &&) = default;
+    SurfacePool &operator=(SurfacePool &&) = default;
+
+    // sortedUnique must be strictly increasing; surface i gets id i.
+    static SurfacePool build(const std::vector<std::u16string> &sortedUnique,
+                             uint32_t bucketSize = kDefaultBucketSize);
+
+    size_t size() const { return static_cast<size_t>(count_); }
+    uint32_t bucketSize() const { return bucketSize_; }
+
+    // Bytes lookups touch (bucket offsets and string data).
+    size_t memoryBytes() const { return offsets_.size_bytes() + data_.size_bytes(); }
+
+    // The caller guarantees id < size(). out is overwritten.
+    void get(uint32_t id, std::u16string &out) const;
+    std::u16string get(uint32_t id) const;
+
+    void saveToFile(const std::string &path) const;
+    static SurfacePool loadFromFile(const std::string &path);
+
+    // Zero-copy: maps the file and reads the arrays in place.
+    static SurfacePool mapFromFile(const std::string &path);
+
+private:
+    uint64_t count_{0};
+    uint32_t bucketSize_{kDefaultBucketSize};
+
+    // Heap storage (empty when mapped)
+    std::vector<uint32_t> offsetsStore_;
+    std::vector<char16_t> dataStore_;
+    std::shared_ptr<const MappedFile> map_;
+
+    // What lookups read: views into the storage above or into map_
+    std::span<const uint32_t> offsets_;
+    std::span<const char16_t> data_;
+
+    void validate(const std::string &what) const;
+};
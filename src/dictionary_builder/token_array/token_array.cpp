@@ -1,5 +1,6 @@
 #include "token_array/token_array.hpp"
 
+#include <cstring>
 #include <fstream>
 #include <stdexcept>
 
@@ -8,32 +9,181 @@ void TokenArray::clear()
     posIndex.clear();
     wordCost.clear();
     nodeIndex.clear();
+    surfaceId.clear();
     postingsBits = BitVector{};
+    postingsIndex_ = SuccinctBitVector{};
+    map_.reset();
+    posIndexView_ = {};
+    wordCostView_ = {};
+    nodeIndexView_ = {};
+    surfaceIdView_ = {};
+    postingsView_ = {};
+    offsets_.clear();
+    offsetsView_ = {};
+    surfacePool_.reset();
+    costSorted_ = false;
 }
 
-std::vector<TokenEntry> TokenArray::getTokensForTermId(int32_t termId) const
+void TokenArray::buildIndex()
+{
+    postingsIndex_ = SuccinctBitVector(postingsBits);
+}
+
+void TokenArray::buildPostingOffsets()
+{
+    const BitVectorView bits = postingsData();
+    offsets_.clear();
+    uint32_t tokens = 0;
+    for (size_t i = 0; i < bits.size(); ++i)
+    {
+        if (bits.get(i))
+            ++tokens;
+        else
+            offsets_.push_back(tokens);
+    }
+    offsets_.push_back(tokens);
+    offsetsView_ = offsets_;
+}
+
+bool TokenArray::offsetsFit(std::span<const uint32_t> offsets) const
+{
+    const BitVectorView bits = postingsData();
+    const size_t tokens = nodeIndexData().size();
+    if (bits.size() < tokens)
+        return false;
+    const size_t terms = bits.size() - tokens; // one 0 per term
+    return offsets.size() == terms + 1 && offsets.front() == 0 && offsets.back() == tokens;
+}
+
+bool TokenArray::tokenRange(int32_t termId, size_t &begin, size_t &end) const
 {
+    if (termId < 0)
+        return false;
+
+    if (const auto offsets = offsetsData(); !offsets.empty())
+    {
+        if (static_cast<size_t>(termId) + 1 >= offsets.size())
+            return false;
+        begin = offsets[static_cast<size_t>(termId)];
+        end = offsets[static_cast<size_t>(termId) + 1];
+        return true;
+    }
+
     // postingsBits stores: 0, then 1* for term0 tokens, 0, 1* for term1 tokens...
     // Our BitVector/SuccinctBitVector select0 is 1-indexed, while termId is 0-based.
-    const int p0 = postingsBits.select0(termId + 1);
-    const int p1 = postingsBits.select0(termId + 2);
-    if (p0 < 0 || p1 < 0)
+    // Without an index (e.g. a builder that never called buildIndex) fall back
+    // to the plain BitVector, which scans from the start.
+    const bool indexed = postingsIndex_.size() == static_cast<int>(postingsData().size());
+    const int p0 = indexed ? postingsIndex_.select0(termId + 1) : postingsBits.select0(termId + 1);
+    if (p0 < 0)
+        return false;
+    // The last term has no 0 after it: its run ends at the end of the bits.
+    int p1 = indexed ? postingsIndex_.select0(termId + 2) : postingsBits.select0(termId + 2);
+    if (p1 < 0)
+        p1 = static_cast<int>(postingsData().size());
+
+    // The k-th 0 (1-indexed) at position p has exactly k 0s in [0, p],
+    // so rank1(p) = (p + 1) - k and no rank query is needed.
+    begin = static_cast<size_t>(p0 - termId);
+    end = static_cast<size_t>(p1 - (termId + 1));
+    return true;
+}
+
+TokenListView TokenArray::tokensForTermId(int32_t termId) const
+{
+    size_t b = 0;
+    size_t e = 0;
+    if (!tokenRange(termId, b, e) || e < b)
         return {};
 
-    const int b = postingsBits.rank1(p0);
-    const int c = postingsBits.rank1(p1);
+    const auto surface = surfaceIdData();
+    return TokenListView(posIndexData().subspan(b, e - b),
+                         wordCostData().subspan(b, e - b),
+                         nodeIndexData().subspan(b, e - b),
+                         surface.empty() ? surface : surface.subspan(b, e - b));
+}
+
+std::vector<TokenEntry> TokenArray::getTokensForTermId(int32_t termId) const
+{
+    const TokenListView list = tokensForTermId(termId);
 
     std::vector<TokenEntry> out;
-    out.reserve(static_cast<size_t>(std::max(0, c - b)));
-    for (int i = b; i < c; ++i)
+    out.reserve(list.size());
+    for (const TokenEntry t : list)
+        out.push_back(t);
+    return out;
+}
+
+void TokenArray::sortPostingsByCost()
+{
+    if (map_)
+        throw std::runtime_error("TokenArray: cannot reorder a mapped token array");
+    if (!surfaceId.empty() && surfaceId.size() != nodeIndex.size())
+        throw std::runtime_error("TokenArray: surface ids do not match the tokens");
+
+    std::vector<TokenEntry> run;
+    size_t begin = 0;
+    const auto sortRun = [&](size_t end)
     {
-        out.push_back(TokenEntry{posIndex[static_cast<size_t>(i)],
-                                 wordCost[static_cast<size_t>(i)],
-                                 nodeIndex[static_cast<size_t>(i)]});
+        run.clear();
+        for (size_t i = begin; i < end; ++i)
+            run.push_back(TokenEntry{posIndex[i], wordCost[i], nodeIndex[i], surfaceId.empty() ? -1 : surfaceId[i]});
+        std::stable_sort(run.begin(), run.end(), [](const TokenEntry &a, const TokenEntry &b)
+                         { return a.wordCost < b.wordCost; });
+        for (size_t j = 0; j < run.size(); ++j)
+        {
+            posIndex[begin + j] = run[j].posIndex;
+            wordCost[begin + j] = run[j].wordCost;
+            nodeIndex[begin + j] = run[j].nodeIndex;
+            if (!surfaceId.empty())
+                surfaceId[begin + j] = run[j].surfaceId;
+        }
+        begin = end;
+    };
+
+    // Runs of 1s in postingsBits are the posting lists, in token order.
+    size_t token = 0;
+    for (size_t i = 0; i < postingsBits.size(); ++i)
+    {
+        if (postingsBits.get(i))
+            ++token;
+        else
+            sortRun(token);
     }
+    sortRun(token);
+    costSorted_ = true;
+}
+
+TokenListView TokenArray::tokensForTermId(int32_t termId, size_t k) const
+{
+    const TokenListView all = tokensForTermId(termId);
+    return costSorted_ ? all.first(k) : all;
+}
+
+std::vector<TokenEntry> TokenArray::getTokensForTermId(int32_t termId, size_t k) const
+{
+    const TokenListView list = tokensForTermId(termId, k);
+
+    std::vector<TokenEntry> out;
+    out.reserve(list.size());
+    for (const TokenEntry t : list)
+        out.push_back(t);
     return out;
 }
 
+void TokenArray::attachSurfacePool(std::shared_ptr<const SurfacePool> pool)
+{
+    const auto ids = surfaceIdData();
+    if (!pool || ids.size() != nodeIndexData().size())
+        throw std::runtime_error("TokenArray: no surface ids for the surface pool");
+    for (int32_t id : ids)
+    {
+        if (id >= 0 && static_cast<size_t>(id) >= pool->size())
+            throw std::runtime_error("TokenArray: surface id out of the pool's range");
+    }
+    surfacePool_ = std::move(pool);
+}
+
 void TokenArray::write_u64(std::ostream &os, uint64_t v)
 {
     os.write(reinterpret_cast<const char *>(&v), sizeof(v));
@@ -76,15 +226,14 @@ void TokenArray::read_i16(std::istream &is, int16_t &v)
     is.read(reinterpret_cast<char *>(&v), sizeof(v));
 }
 
-void TokenArray::writeBitVector(std::ostream &os, const BitVector &bv)
+void TokenArray::writeBitVector(std::ostream &os, BitVectorView bv)
 {
     write_u64(os, static_cast<uint64_t>(bv.size()));
-    const auto &w = bv.words();
-    write_u64(os, static_cast<uint64_t>(w.size()));
-    if (!w.empty())
+    write_u64(os, static_cast<uint64_t>(bv.numWords()));
+    if (bv.numWords() > 0)
     {
-        os.write(reinterpret_cast<const char *>(w.data()),
-                 static_cast<std::streamsize>(w.size() * sizeof(uint64_t)));
+        os.write(reinterpret_cast<const char *>(bv.words()),
+                 static_cast<std::streamsize>(bv.numWords() * sizeof(uint64_t)));
     }
 }
 
@@ -105,32 +254,92 @@ BitVector TokenArray::readBitVector(std::istream &is)
     return bv;
 }
 
-void TokenArray::saveToFile(const std::string &path) const
+template <class T>
+void TokenArray::writeArrayV2(std::ostream &os, std::span<const T> v)
+{
+    static const char zeros[8] = {};
+    write_u64(os, static_cast<uint64_t>(v.size()));
+    if (!v.empty())
+        os.write(reinterpret_cast<const char *>(v.data()), static_cast<std::streamsize>(v.size_bytes()));
+    const size_t pad = (8 - (v.size_bytes() & 7)) & 7;
+    if (pad > 0)
+        os.write(zeros, static_cast<std::streamsize>(pad));
+}
+
+template <class T>
+void TokenArray::readArrayV2(std::istream &is, std::vector<T> &v)
+{
+    uint64_t n = 0;
+    read_u64(is, n);
+    v.resize(static_cast<size_t>(n));
+    if (n > 0)
+        is.read(reinterpret_cast<char *>(v.data()), static_cast<std::streamsize>(n * sizeof(T)));
+    const size_t pad = (8 - ((n * sizeof(T)) & 7)) & 7;
+    is.ignore(static_cast<std::streamsize>(pad));
+}
+
+template <class T>
+static void readArrayV1(std::istream &is, std::vector<T> &v)
+{
+    uint32_t n = 0;
+    is.read(reinterpret_cast<char *>(&n), sizeof(n));
+    v.resize(n);
+    if (n > 0)
+        is.read(reinterpret_cast<char *>(v.data()), static_cast<std::streamsize>(n * sizeof(T)));
+}
+
+void TokenArray::saveToFile(const std::string &path, bool withIndex) const
 {
     std::ofstream ofs(path, std::ios::binary);
     if (!ofs)
         throw std::runtime_error("failed to open file for write: " + path);
 
-    // posIndex
-    write_u32(ofs, static_cast<uint32_t>(posIndex.size()));
-    if (!posIndex.empty())
-        ofs.write(reinterpret_cast<const char *>(posIndex.data()),
-                  static_cast<std::streamsize>(posIndex.size() * sizeof(uint16_t)));
+    // v2: every array starts 8-byte aligned (see kMagicV2)
+    write_u64(ofs, kMagicV2);
+    writeArrayV2(ofs, posIndexData());
+    writeArrayV2(ofs, wordCostData());
+    writeArrayV2(ofs, nodeIndexData());
 
-    // wordCost
-    write_u32(ofs, static_cast<uint32_t>(wordCost.size()));
-    if (!wordCost.empty())
-        ofs.write(reinterpret_cast<const char *>(wordCost.data()),
-                  static_cast<std::streamsize>(wordCost.size() * sizeof(int16_t)));
+    // postingsBits
+    writeBitVector(ofs, postingsData());
 
-    // nodeIndex
-    write_u32(ofs, static_cast<uint32_t>(nodeIndex.size()));
-    if (!nodeIndex.empty())
-        ofs.write(reinterpret_cast<const char *>(nodeIndex.data()),
-                  static_cast<std::streamsize>(nodeIndex.size() * sizeof(int32_t)));
+    FileSections sections;
+    if (withIndex)
+        sections.add(FileSections::kPostingsIndex, SuccinctBitVector(postingsData()).serializeIndex());
+    if (const auto offsets = offsetsData(); !offsets.empty())
+    {
+        const uint64_t n = static_cast<uint64_t>(offsets.size());
+        std::vector<uint8_t> bytes(sizeof(n) + offsets.size_bytes());
+        std::memcpy(bytes.data(), &n, sizeof(n));
+        std::memcpy(bytes.data() + sizeof(n), offsets.data(), offsets.size_bytes());
+        sections.add(FileSections::kPostingOffsets, std::move(bytes));
+    }
+    if (costSorted_)
+        sections.add(FileSections::kSortedPostings, {});
+    if (const auto ids = surfaceIdData(); !ids.empty())
+    {
+        const uint64_t n = static_cast<uint64_t>(ids.size());
+        std::vector<uint8_t> bytes(sizeof(n) + ids.size_bytes());
+        std::memcpy(bytes.data(), &n, sizeof(n));
+        std::memcpy(bytes.data() + sizeof(n), ids.data(), ids.size_bytes());
+        sections.add(FileSections::kSurfaceIds, std::move(bytes));
+    }
+    if (!sections.empty())
+        sections.write(ofs);
+}
 
-    // postingsBits
-    writeBitVector(ofs, postingsBits);
+// u64 n, T values[n] (a kSurfaceIds or kPostingOffsets section)
+template <class T>
+static bool viewSection(std::span<const uint8_t> section, std::span<const T> &values)
+{
+    uint64_t n = 0;
+    if (section.size() < sizeof(n))
+        return false;
+    std::memcpy(&n, section.data(), sizeof(n));
+    if (n > (section.size() - sizeof(n)) / sizeof(T))
+        return false;
+    values = {reinterpret_cast<const T *>(section.data() + sizeof(n)), static_cast<size_t>(n)};
+    return true;
 }
 
 TokenArray TokenArray::loadFromFile(const std::string &path)
@@ -141,25 +350,80 @@ TokenArray TokenArray::loadFromFile(const std::string &path)
 
     TokenArray t;
 
-    uint32_t n = 0;
-    read_u32(ifs, n);
-    t.posIndex.resize(n);
-    if (n > 0)
-        ifs.read(reinterpret_cast<char *>(t.posIndex.data()),
-                 static_cast<std::streamsize>(n * sizeof(uint16_t)));
+    uint64_t magic = 0;
+    read_u64(ifs, magic);
+    if (ifs && magic == kMagicV2)
+    {
+        readArrayV2(ifs, t.posIndex);
+        readArrayV2(ifs, t.wordCost);
+        readArrayV2(ifs, t.nodeIndex);
+    }
+    else
+    {
+        // v1: u32 count before each array, no padding
+        ifs.clear();
+        ifs.seekg(0);
+        readArrayV1(ifs, t.posIndex);
+        readArrayV1(ifs, t.wordCost);
+        readArrayV1(ifs, t.nodeIndex);
+    }
 
-    read_u32(ifs, n);
-    t.wordCost.resize(n);
-    if (n > 0)
-        ifs.read(reinterpret_cast<char *>(t.wordCost.data()),
-                 static_cast<std::streamsize>(n * sizeof(int16_t)));
+    t.postingsBits = readBitVector(ifs);
+    if (!ifs)
+        throw std::runtime_error("TokenArray: truncated file: " + path);
 
-    read_u32(ifs, n);
-    t.nodeIndex.resize(n);
-    if (n > 0)
-        ifs.read(reinterpret_cast<char *>(t.nodeIndex.data()),
-                 static_cast<std::streamsize>(n * sizeof(int32_t)));
+    const FileSections sections = FileSections::read(ifs);
+    t.postingsIndex_ = SuccinctBitVector::adopt(t.postingsBits, sections.find(FileSections::kPostingsIndex));
+    if (const auto *bytes = sections.find(FileSections::kSurfaceIds))
+    {
+        std::span<const int32_t> ids;
+        if (!viewSection(*bytes, ids) || ids.size() != t.nodeIndex.size())
+            throw std::runtime_error("TokenArray: malformed surface ids: " + path);
+        t.surfaceId.assign(ids.begin(), ids.end());
+    }
+    if (const auto *bytes = sections.find(FileSections::kPostingOffsets))
+    {
+        std::span<const uint32_t> offsets;
+        if (!viewSection(*bytes, offsets) || !t.offsetsFit(offsets))
+            throw std::runtime_error("TokenArray: malformed posting offsets: " + path);
+        t.offsets_.assign(offsets.begin(), offsets.end());
+        t.offsetsView_ = t.offsets_;
+    }
+    t.costSorted_ = sections.find(FileSections::kSortedPostings) != nullptr;
+    return t;
+}
 
-    t.postingsBits = readBitVector(ifs);
+TokenArray TokenArray::mapFromFile(const std::string &path)
+{
+    auto map = MappedFile::open(path);
+
+    MappedReader in(map->data(), map->size(), "TokenArray: " + path);
+    if (map->size() < sizeof(uint64_t) || in.u64() != kMagicV2)
+        return loadFromFile(path); // v1 layout is not aligned: fall back to a copy
+
+    TokenArray t;
+    t.posIndexView_ = in.array<uint16_t>(static_cast<size_t>(in.u64()));
+    in.align(8);
+    t.wordCostView_ = in.array<int16_t>(static_cast<size_t>(in.u64()));
+    in.align(8);
+    t.nodeIndexView_ = in.array<int32_t>(static_cast<size_t>(in.u64()));
+    in.align(8);
+    t.postingsView_ = in.bits();
+
+    t.postingsIndex_ = SuccinctBitVector::adoptView(
+        t.postingsView_,
+        FileSections::locate(map->data(), map->size(), FileSections::kPostingsIndex));
+    if (const auto bytes = FileSections::locate(map->data(), map->size(), FileSections::kSurfaceIds))
+    {
+        if (!viewSection(*bytes, t.surfaceIdView_) || t.surfaceIdView_.size() != t.nodeIndexView_.size())
+            in.fail("malformed surface ids");
+    }
+    t.map_ = std::move(map); // offsetsFit reads the mapped arrays
+    if (const auto bytes = FileSections::locate(t.map_->data(), t.map_->size(), FileSections::kPostingOffsets))
+    {
+        if (!viewSection(*bytes, t.offsetsView_) || !t.offsetsFit(t.offsetsView_))
+            in.fail("malformed posting offsets");
+    }
+    t.costSorted_ = FileSections::locate(t.map_->data(), t.map_->size(), FileSections::kSortedPostings).has_value();
     return t;
 }
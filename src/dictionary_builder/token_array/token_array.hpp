@@ -1,12 +1,18 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "./common/bit_vector_utf16.hpp"
+#include "./common/file_sections_utf16.hpp"
+#include "./common/mapped_file_utf16.hpp"
+#include "./common/succinct_bit_vector_utf16.hpp"
+#include "token_array/surface_pool.hpp"
 
 // TokenArray is the per-yomi posting list used by the converter.
 //
@@ -17,12 +23,100 @@
 //
 // termId is 0-based and corresponds to the order of yomi keys
 // in the sorted dictionary (length asc, then lex asc).
+//
+// Lookups go through a rank/select index over postingsBits that is built
+// by loadFromFile (or buildIndex() after filling the arrays by hand), so a
+// lookup no longer scans the bitvector from position 0.
+// saveToFile(path, true) persists that index as a FileSections section, and
+// loadFromFile adopts it instead of rebuilding it when present.
+//
+// token_array.bin (v2, written by saveToFile):
+//   u64 kMagicV2
+//   u64 n, u16 posIndex[n],  zero padding to 8
+//   u64 n, i16 wordCost[n],  zero padding to 8
+//   u64 n, i32 nodeIndex[n], zero padding to 8
+//   u64 nbits, u64 nwords, u64 postingsBits words[nwords]
+//   [FileSections]
+// Every array starts 8-byte aligned, so mapFromFile can use them in place.
+// v1 (no magic, u32 counts, no padding) is still accepted by loadFromFile.
+//
+// Optionally each token also carries the id of its surface in a SurfacePool
+// (FileSections::kSurfaceIds). With a pool attached, the converter decodes
+// surfaces from the pool instead of walking the tango trie.
+//
+// With FileSections::kPostingOffsets (or after buildPostingOffsets()), the
+// tokens of termId are [offsets[termId], offsets[termId + 1]): two loads
+// instead of two select0 calls.
+//
+// With FileSections::kSortedPostings (or after sortPostingsByCost()), each
+// posting list is in ascending wordCost order, so its k cheapest tokens are a
+// prefix of it (tokensForTermId(termId, k)).
 
 struct TokenEntry
 {
     uint16_t posIndex;
     int16_t wordCost;
     int32_t nodeIndex; // tango LOUDS node index; may be -1/-2 sentinels
+    int32_t surfaceId = -1; // SurfacePool id; -1 for sentinels or without kSurfaceIds
+};
+
+// The tokens of one termId, read in place from TokenArray's arrays (no copy).
+// Valid while the TokenArray it came from is alive and unmodified.
+class TokenListView
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(const TokenListView *list, size_t i) : list_(list), i_(i) {}
+        TokenEntry operator*() const { return (*list_)[i_]; }
+        Iterator &operator++()
+        {
+            ++i_;
+            return *this;
+        }
+        bool operator==(const Iterator &o) const { return i_ == o.i_; }
+        bool operator!=(const Iterator &o) const { return i_ != o.i_; }
+
+    private:
+        const TokenListView *list_;
+        size_t i_;
+    };
+
+    TokenListView() = default;
+    TokenListView(std::span<const uint16_t> posIndex,
+                  std::span<const int16_t> wordCost,
+                  std::span<const int32_t> nodeIndex,
+                  std::span<const int32_t> surfaceId)
+        : posIndex_(posIndex), wordCost_(wordCost), nodeIndex_(nodeIndex), surfaceId_(surfaceId)
+    {
+    }
+
+    size_t size() const { return posIndex_.size(); }
+    bool empty() const { return posIndex_.empty(); }
+
+    TokenEntry operator[](size_t i) const
+    {
+        return TokenEntry{posIndex_[i], wordCost_[i], nodeIndex_[i], surfaceId_.empty() ? -1 : surfaceId_[i]};
+    }
+
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, size()); }
+
+    // The first min(k, size()) tokens
+    TokenListView first(size_t k) const
+    {
+        if (k >= size())
+            return *this;
+        return TokenListView(posIndex_.first(k), wordCost_.first(k), nodeIndex_.first(k),
+                             surfaceId_.empty() ? surfaceId_ : surfaceId_.first(k));
+    }
+
+private:
+    std::span<const uint16_t> posIndex_;
+    std::span<const int16_t> wordCost_;
+    std::span<const int32_t> nodeIndex_;
+    std::span<const int32_t> surfaceId_; // empty without surface ids
 };
 
 class TokenArray
@@ -31,21 +125,99 @@ public:
     static constexpr int32_t HIRAGANA_SENTINEL = -2;
     static constexpr int32_t KATAKANA_SENTINEL = -1;
 
+    TokenArray() = default;
+
+    // postingsIndex_ points into postingsBits' word buffer, which survives a
+    // move but not a copy.
+    TokenArray(const TokenArray &) = delete;
+    TokenArray &operator=(const TokenArray &) = delete;
+    TokenArray(TokenArray &&) = default;
+    TokenArray &operator=(TokenArray &&) = default;
+
     void clear();
 
-    // Query tokens for a termId (0-based).
+    // (Re)builds the rank/select index over postingsBits.
+    // Must be called again after postingsBits is modified.
+    void buildIndex();
+
+    // Fills the posting offsets from postingsBits (one scan). saveToFile then
+    // writes them as FileSections::kPostingOffsets. Must be called again after
+    // postingsBits is modified.
+    void buildPostingOffsets();
+    bool hasPostingOffsets() const { return !offsetsData().empty(); }
+
+    // Tokens of a termId (0-based) without copying or allocating; empty for an
+    // unknown termId. O(1) with posting offsets, two select0 calls otherwise.
+    TokenListView tokensForTermId(int32_t termId) const;
+
+    // Query tokens for a termId (0-based). A copy of tokensForTermId.
     std::vector<TokenEntry> getTokensForTermId(int32_t termId) const;
 
-    void saveToFile(const std::string &path) const;
+    // Reorders every posting list by ascending wordCost (stable), keeping the
+    // per-token arrays aligned. saveToFile then marks the file with
+    // FileSections::kSortedPostings. Only for arrays held in the vectors
+    // (not mapped).
+    void sortPostingsByCost();
+    bool postingsCostSorted() const { return costSorted_; }
+
+    // The k cheapest tokens of termId when the lists are cost-sorted; all of
+    // them otherwise.
+    TokenListView tokensForTermId(int32_t termId, size_t k) const;
+    std::vector<TokenEntry> getTokensForTermId(int32_t termId, size_t k) const;
+
+    void saveToFile(const std::string &path, bool withIndex = false) const;
     static TokenArray loadFromFile(const std::string &path);
 
+    // Zero-copy: maps the file and reads the arrays in place (the public
+    // vectors stay empty). v1 files are not aligned and fall back to loadFromFile.
+    static TokenArray mapFromFile(const std::string &path);
+
+    // Attaches the pool the surface ids refer to. Throws if the tokens have no
+    // surface ids or an id is out of the pool's range.
+    void attachSurfacePool(std::shared_ptr<const SurfacePool> pool);
+    // nullptr unless attachSurfacePool was called
+    const SurfacePool *surfacePool() const { return surfacePool_.get(); }
+
     // Public data (useful for debugging/inspection)
     std::vector<uint16_t> posIndex;
     std::vector<int16_t> wordCost;
     std::vector<int32_t> nodeIndex;
+    std::vector<int32_t> surfaceId; // empty, or one SurfacePool id per token
     BitVector postingsBits; // 0 then 1* for each term
 
 private:
+    static constexpr uint64_t kMagicV2 = 0x3252414B4F544B4BULL; // "KKTOKAR2"
+
+    SuccinctBitVector postingsIndex_;
+
+    // Set by mapFromFile only; the views point into map_.
+    std::shared_ptr<const MappedFile> map_;
+    std::span<const uint16_t> posIndexView_;
+    std::span<const int16_t> wordCostView_;
+    std::span<const int32_t> nodeIndexView_;
+    std::span<const int32_t> surfaceIdView_;
+    BitVectorView postingsView_;
+
+    // Posting offsets: a view into offsets_ (built or loaded) or into map_
+    std::vector<uint32_t> offsets_;
+    std::span<const uint32_t> offsetsView_;
+
+    std::shared_ptr<const SurfacePool> surfacePool_;
+
+    bool costSorted_{false};
+
+    std::span<const uint16_t> posIndexData() const { return map_ ? posIndexView_ : std::span<const uint16_t>(posIndex); }
+    std::span<const int16_t> wordCostData() const { return map_ ? wordCostView_ : std::span<const int16_t>(wordCost); }
+    std::span<const int32_t> nodeIndexData() const { return map_ ? nodeIndexView_ : std::span<const int32_t>(nodeIndex); }
+    std::span<const int32_t> surfaceIdData() const { return map_ ? surfaceIdView_ : std::span<const int32_t>(surfaceId); }
+    std::span<const uint32_t> offsetsData() const { return offsetsView_; }
+
+    // [begin, end) token range of termId; false if termId is unknown
+    bool tokenRange(int32_t termId, size_t &begin, size_t &end) const;
+    // Whether offsets fits this posting bitvector (sizes and end points)
+    bool offsetsFit(std::span<const uint32_t> offsets) const;
+    BitVectorView postingsData() const { return map_ ? postingsView_ : BitVectorView(postingsBits); }
+
     static void write_u64(std::ostream &os, uint64_t v);
     static void write_u32(std::ostream &os, uint32_t v);
     static void write_i32(std::ostream &os, int32_t v);
@@ -58,6 +230,11 @@ private:
     static void read_u16(std::istream &is, uint16_t &v);
     static void read_i16(std::istream &is, int16_t &v);
 
-    static void writeBitVector(std::ostream &os, const BitVector &bv);
+    static void writeBitVector(std::ostream &os, BitVectorView bv);
     static BitVector readBitVector(std::istream &is);
+
+    template <class T>
+    static void writeArrayV2(std::ostream &os, std::span<const T> v);
+    template <class T>
+    static void readArrayV2(std::istream &is, std::vector<T> &v);
 };
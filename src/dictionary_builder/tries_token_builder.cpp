@@ -17,12 +17,28 @@
 //     src/dictionary_builder/louds_builder/louds/louds_utf16_reader.cpp \
 //     src/dictionary_builder/louds_builder/louds_with_term_id/louds_with_term_id_utf16.cpp \
 //     src/dictionary_builder/louds_builder/louds_with_term_id/louds_converter_with_term_id_utf16.cpp \
+//     src/dictionary_builder/louds_builder/double_array/double_array_utf16.cpp \
+//     src/dictionary_builder/louds_builder/patricia/patricia_louds_utf16.cpp \
+//     src/dictionary_builder/louds_builder/dawg/dawg_utf16.cpp \
 //     src/dictionary_builder/token_array/token_array.cpp \
+//     src/dictionary_builder/token_array/surface_pool.cpp \
 //     -o buildTriesToken
 //
 // Run:
 //   ./buildTriesToken --in_dir src/dictionary_builder/mozc_fetch --out_dir build
 //   ./buildTriesToken --in_dir ... --out_dir ... --quiet
+//   ./buildTriesToken --in_dir ... --out_dir ... --no_index   (omit persisted rank/select indexes)
+//   ./buildTriesToken --in_dir ... --out_dir ... --leaf_rank_term_ids (derive yomi termIds from isLeaf rank, omit termIdByNodeId;
+//                                                                       readers from before this option return no termIds)
+//   ./buildTriesToken --in_dir ... --out_dir ... --no_predict_costs (omit the predictive-search costs of yomi_termid.louds)
+//   ./buildTriesToken --in_dir ... --out_dir ... --no_tango_parents (omit the parent table getLetter uses in tango.louds)
+//   ./buildTriesToken --in_dir ... --out_dir ... --no_posting_offsets (omit the per-termId token offsets of token_array.bin)
+//   ./buildTriesToken --in_dir ... --out_dir ... --keep_posting_order (keep dictionary order in each posting list instead of sorting by cost)
+//   ./buildTriesToken --in_dir ... --out_dir ... --labels8         (store yomi labels as 8-bit alphabet codes)
+//   ./buildTriesToken --in_dir ... --out_dir ... --double_array    (also write yomi_termid.da, the double-array yomi trie)
+//   ./buildTriesToken --in_dir ... --out_dir ... --patricia        (also write yomi_termid.plouds, the path-compressed yomi trie)
+//   ./buildTriesToken --in_dir ... --out_dir ... --dawg            (also write yomi_termid.dawg, the minimized yomi automaton)
+//   ./buildTriesToken --in_dir ... --out_dir ... --surface_pool    (also write tango_surfaces.bin and per-token surface ids)
 //
 // Dump registrations (VERY LARGE):
 //   ./buildTriesToken --in_dir ... --out_dir ... --dump_all
@@ -30,6 +46,7 @@
 
 #include <algorithm>
 #include <charconv>
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
@@ -44,13 +61,17 @@
 #include <utility>
 #include <vector>
 
+#include "dawg/dawg_utf16.hpp"
+#include "double_array/double_array_utf16.hpp"
 #include "louds/louds_converter_utf16.hpp"
 #include "louds_builder/louds_with_term_id/louds_converter_with_term_id_utf16.hpp"
 #include "louds/louds_utf16_reader.hpp"
 #include "louds/louds_utf16_writer.hpp"
 #include "louds_with_term_id/louds_with_term_id_utf16.hpp"
+#include "patricia/patricia_louds_utf16.hpp"
 #include "prefix_tree/prefix_tree_utf16.hpp"
 #include "prefix_tree_with_term_id/prefix_tree_with_term_id_utf16.hpp"
+#include "token_array/surface_pool.hpp"
 #include "token_array/token_array.hpp"
 
 namespace fs = std::filesystem;
@@ -384,6 +405,17 @@ int main(int argc, char **argv)
         fs::path out_dir = "build";
         bool dump_all = false;
         bool dump_yomi = false;
+        bool with_index = true;
+        bool leaf_rank_term_ids = false;
+        bool predict_costs = true;
+        bool tango_parents = true;
+        bool posting_offsets = true;
+        bool sort_postings = true;
+        bool labels8 = false;
+        bool double_array = false;
+        bool patricia = false;
+        bool dawg = false;
+        bool surface_pool = false;
         std::u16string dump_yomi_u16;
 
         for (int i = 1; i < argc; ++i)
@@ -395,6 +427,28 @@ int main(int argc, char **argv)
                 out_dir = argv[++i];
             else if (a == "--dump_all")
                 dump_all = true;
+            else if (a == "--no_index")
+                with_index = false;
+            else if (a == "--leaf_rank_term_ids")
+                leaf_rank_term_ids = true;
+            else if (a == "--no_predict_costs")
+                predict_costs = false;
+            else if (a == "--no_tango_parents")
+                tango_parents = false;
+            else if (a == "--no_posting_offsets")
+                posting_offsets = false;
+            else if (a == "--keep_posting_order")
+                sort_postings = false;
+            else if (a == "--labels8")
+                labels8 = true;
+            else if (a == "--double_array")
+                double_array = true;
+            else if (a == "--patricia")
+                patricia = true;
+            else if (a == "--dawg")
+                dawg = true;
+            else if (a == "--surface_pool")
+                surface_pool = true;
             else if (a == "--dump_yomi" && i + 1 < argc)
             {
                 dump_yomi = true;
@@ -517,13 +571,87 @@ int main(int argc, char **argv)
         }
 
         // 5) Convert to LOUDS and persist
-        const auto yomiLOUDS = ConverterWithTermIdUtf16().convert(yomiTree.root());
+        auto yomiLOUDS = ConverterWithTermIdUtf16().convert(yomiTree.root());
         const auto tangoLOUDS = ConverterUtf16().convert(tangoTree.getRoot());
 
+        // termIds follow (length asc, lex asc), i.e. the BFS order of terminal nodes,
+        // so they can be derived from rank on isLeaf instead of stored per node.
+        if (leaf_rank_term_ids)
+        {
+            if (yomiLOUDS.useLeafRankTermIds())
+                std::cerr << "yomi termIds: leaf rank (termIdByNodeId omitted)\n";
+            else
+                std::cerr << "yomi termIds: leaf-rank invariant does not hold, keeping termIdByNodeId\n";
+        }
+
+        // Per-subtree minimum word cost for best-first predictive search. The
+        // cost of a termId is the lowest wordCost among its tokens, i.e. the
+        // minimum over the rows TokenArray stores for it in step 7.
+        if (predict_costs)
+        {
+            std::vector<int16_t> minCostByTermId(keys.size());
+            for (size_t termId = 0; termId < keys.size(); ++termId)
+            {
+                const auto &list = grouped.at(keys[termId]);
+                int16_t best = LOUDSWithTermIdUtf16::kNoCost;
+                for (const auto &row : list)
+                    best = std::min(best, row.cost);
+                minCostByTermId[termId] = best;
+            }
+            yomiLOUDS.setWordCosts(minCostByTermId);
+        }
+
+        // 8-bit labels: only readers that know FileSections::kLabels8 can read the file.
+        if (labels8)
+        {
+            const size_t before = yomiLOUDS.labels.size() * sizeof(char16_t);
+            yomiLOUDS.useAlphabetLabels();
+            std::cerr << "yomi labels: 8-bit alphabet, " << yomiLOUDS.labels8.size() << " bytes (was " << before << ")\n";
+        }
+
         const fs::path yomiPath = out_dir / "yomi_termid.louds";
         const fs::path tangoPath = out_dir / "tango.louds";
-        yomiLOUDS.saveToFile(yomiPath.string());
-        tangoLOUDS.saveToFile(tangoPath.string());
+        yomiLOUDS.saveToFile(yomiPath.string(), with_index);
+        tangoLOUDS.saveToFile(tangoPath.string(), with_index, tango_parents);
+
+        // Path-compressed variant of the yomi trie (same termIds)
+        if (patricia)
+        {
+            const auto yomiPatricia = PatriciaLOUDSUtf16::convert(yomiTree.root());
+            const fs::path patriciaPath = out_dir / "yomi_termid.plouds";
+            yomiPatricia.saveToFile(patriciaPath.string(), with_index);
+            std::cerr << "yomi patricia: LBS " << yomiPatricia.LBS.size() << " bits (LOUDS " << yomiLOUDS.LBS.size()
+                      << "), tail pool " << yomiPatricia.tailPool.size() << " code units\n";
+        }
+
+        // Double-array backend for the yomi trie, from the same keys and termIds
+        if (double_array)
+        {
+            std::vector<int32_t> termIds(keys.size());
+            for (size_t termId = 0; termId < keys.size(); ++termId)
+                termIds[termId] = static_cast<int32_t>(termId);
+
+            const auto yomiDA = DoubleArrayUtf16::build(keys, termIds);
+            const fs::path daPath = out_dir / "yomi_termid.da";
+            yomiDA.saveToFile(daPath.string());
+            std::cerr << "yomi double array: " << yomiDA.units.size() << " units\n";
+        }
+
+        // Minimized automaton (suffixes shared), termIds by path-count rank
+        if (dawg)
+        {
+            std::vector<int32_t> termIds(keys.size());
+            for (size_t termId = 0; termId < keys.size(); ++termId)
+                termIds[termId] = static_cast<int32_t>(termId);
+
+            const auto yomiDawg = DawgUtf16::build(keys, termIds);
+            const fs::path dawgPath = out_dir / "yomi_termid.dawg";
+            yomiDawg.saveToFile(dawgPath.string());
+            std::cerr << "yomi dawg: " << yomiDawg.stateCount() << " states, " << yomiDawg.edgeCount()
+                      << " edges (trie " << yomiLOUDS.LBS.size() / 2 - 1 << " nodes), " << fs::file_size(dawgPath)
+                      << " bytes, " << yomiDawg.termIdByRank.words.size() * sizeof(uint64_t)
+                      << " of them rank -> termId (yomi_termid.louds " << fs::file_size(yomiPath) << " bytes)\n";
+        }
 
         // 6) Reload tango LOUDS for nodeIndex lookup
         const auto tangoReader = LOUDSReaderUtf16::loadFromFile(tangoPath.string());
@@ -570,8 +698,82 @@ int main(int argc, char **argv)
             }
         }
 
+        // Front-coded pool of the tango surfaces; each token gets the id of its surface
+        if (surface_pool)
+        {
+            std::vector<std::u16string> surfaces;
+            surfaces.reserve(tokens.nodeIndex.size());
+            for (int32_t nodeIdx : tokens.nodeIndex)
+            {
+                if (nodeIdx >= 0)
+                    surfaces.push_back(tangoReader.getLetter(nodeIdx));
+            }
+            std::sort(surfaces.begin(), surfaces.end());
+            surfaces.erase(std::unique(surfaces.begin(), surfaces.end()), surfaces.end());
+
+            const auto pool = SurfacePool::build(surfaces);
+            const fs::path poolPath = out_dir / "tango_surfaces.bin";
+            pool.saveToFile(poolPath.string());
+
+            // The constructor ignores file sections, so this reader climbs with
+            // rank/select: the pool must also match getLetter without the parent table.
+            const LOUDSReaderUtf16 tangoClimb(tangoLOUDS.LBS, tangoLOUDS.isLeaf, tangoLOUDS.labels);
+
+            tokens.surfaceId.reserve(tokens.nodeIndex.size());
+            size_t withSurface = 0;
+            std::u16string decoded;
+            for (int32_t nodeIdx : tokens.nodeIndex)
+            {
+                if (nodeIdx < 0)
+                {
+                    tokens.surfaceId.push_back(-1);
+                    continue;
+                }
+                const std::u16string s = tangoReader.getLetter(nodeIdx);
+                const auto id = static_cast<uint32_t>(std::lower_bound(surfaces.begin(), surfaces.end(), s) - surfaces.begin());
+                pool.get(id, decoded);
+                if (decoded != s || decoded != tangoClimb.getLetter(nodeIdx))
+                    throw std::runtime_error("surface pool round-trip mismatch");
+                tokens.surfaceId.push_back(static_cast<int32_t>(id));
+                ++withSurface;
+            }
+
+            // What the converter pays per token surface, both ways
+            size_t sink = 0;
+            const auto t0 = std::chrono::steady_clock::now();
+            for (int32_t nodeIdx : tokens.nodeIndex)
+            {
+                if (nodeIdx >= 0)
+                    sink += tangoReader.getLetter(nodeIdx).size();
+            }
+            const auto t1 = std::chrono::steady_clock::now();
+            for (int32_t id : tokens.surfaceId)
+            {
+                if (id >= 0)
+                {
+                    pool.get(static_cast<uint32_t>(id), decoded);
+                    sink += decoded.size();
+                }
+            }
+            const auto t2 = std::chrono::steady_clock::now();
+            const double n = static_cast<double>(std::max<size_t>(1, withSurface));
+
+            std::cerr << "tango surface pool: " << pool.size() << " surfaces, " << fs::file_size(poolPath)
+                      << " bytes (tango.louds " << fs::file_size(tangoPath) << " bytes) + "
+                      << tokens.surfaceId.size() * sizeof(int32_t) << " bytes of surface ids; decode " << std::fixed
+                      << std::setprecision(1) << std::chrono::duration<double, std::nano>(t2 - t1).count() / n
+                      << " ns/token (getLetter " << std::chrono::duration<double, std::nano>(t1 - t0).count() / n
+                      << ", checksum " << sink << ")\n";
+        }
+
+        // Cheapest tokens first, so a reader can take the top k of a list as a prefix
+        if (sort_postings)
+            tokens.sortPostingsByCost();
+        if (posting_offsets)
+            tokens.buildPostingOffsets();
+
         const fs::path tokenPath = out_dir / "token_array.bin";
-        tokens.saveToFile(tokenPath.string());
+        tokens.saveToFile(tokenPath.string(), with_index);
 
         return 0;
     }
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <fstream>
 #include <stdexcept>
+#include <string_view>
 
 namespace kk
 {
@@ -42,12 +43,27 @@ namespace kk
         return t;
     }
 
+    PosTable PosTable::mapFromFile(const std::string &path)
+    {
+        PosTable t;
+        t.map_ = MappedFile::open(path);
+
+        MappedReader in(t.map_->data(), t.map_->size(), "PosTable: " + path);
+        const uint32_t n = in.u32();
+        t.leftView_ = in.array<int16_t>(n);
+        t.rightView_ = in.array<int16_t>(n);
+        return t;
+    }
+
     std::pair<int16_t, int16_t> PosTable::getLR(uint16_t posIndex) const
     {
+        const std::span<const int16_t> left = map_ ? leftView_ : std::span<const int16_t>(leftIds);
+        const std::span<const int16_t> right = map_ ? rightView_ : std::span<const int16_t>(rightIds);
+
         const size_t i = static_cast<size_t>(posIndex);
-        if (i >= leftIds.size() || i >= rightIds.size())
+        if (i >= left.size() || i >= right.size())
             return {0, 0};
-        return {leftIds[i], rightIds[i]};
+        return {left[i], right[i]};
     }
 
     // -----------------------------
@@ -81,7 +97,7 @@ namespace kk
     // -----------------------------
     // Hiragana -> Katakana
     // -----------------------------
-    static std::u16string hira_to_kata(const std::u16string &hira)
+    static std::u16string hira_to_kata(std::u16string_view hira)
     {
         std::u16string out;
         out.reserve(hira.size());
@@ -157,16 +173,90 @@ namespace kk
         }
     }
 
+    // -----------------------------
+    // Token nodes of one yomi hit
+    // -----------------------------
+    // input[i, i + length) matched the key yomi (equal to the input except for
+    // fuzzy hits); each token of termId becomes a node ending at i + length,
+    // its word cost raised by extraCost. Only the maxTokensPerTerm cheapest
+    // tokens are added (all of them for SIZE_MAX).
+    static void addTokenNodes(
+        Graph &graph,
+        int i,
+        std::u16string_view yomi,
+        uint32_t length,
+        int32_t termId,
+        int extraCost,
+        const TokenArray &tokens,
+        const PosTable &pos,
+        const LOUDSReaderUtf16 &tango,
+        size_t maxTokensPerTerm)
+    {
+        const TokenListView listToken = tokens.tokensForTermId(termId, maxTokensPerTerm);
+        const int endIndex = i + static_cast<int>(length);
+
+        for (const TokenEntry t : listToken)
+        {
+            std::u16string surface;
+            if (t.nodeIndex == TokenArray::HIRAGANA_SENTINEL)
+            {
+                surface = yomi;
+            }
+            else if (t.nodeIndex == TokenArray::KATAKANA_SENTINEL)
+            {
+                surface = hira_to_kata(yomi);
+            }
+            else if (t.surfaceId >= 0 && tokens.surfacePool())
+            {
+                tokens.surfacePool()->get(static_cast<uint32_t>(t.surfaceId), surface);
+            }
+            else
+            {
+                surface = tango.getLetter(t.nodeIndex);
+            }
+
+            const auto [l, r] = pos.getLR(t.posIndex);
+            const int cost = static_cast<int>(t.wordCost) + extraCost;
+
+            Node node(
+                /*l=*/l,
+                /*r=*/r,
+                /*score=*/cost,
+                /*f=*/cost, // initial f=word cost (forwardDp will overwrite with best path cost)
+                /*g=*/cost, // initial g is not used directly; backward search keeps g in state
+                /*tango=*/std::move(surface),
+                /*len=*/static_cast<int16_t>(length),
+                /*sPos=*/i);
+
+            addOrUpdateNode(graph, endIndex, node);
+        }
+    }
+
     // -----------------------------
     // GraphBuilder::constructGraph
     // -----------------------------
-    Graph GraphBuilder::constructGraph(
+    // A cap keeps the first maxTokensPerTerm tokens of each posting list, which
+    // are the cheapest only when the lists are cost-sorted.
+    static void checkTokenCap(const TokenArray &tokens, size_t maxTokensPerTerm)
+    {
+        if (maxTokensPerTerm == 0)
+            throw std::runtime_error("GraphBuilder: maxTokensPerTerm must be at least 1");
+        if (maxTokensPerTerm != SIZE_MAX && !tokens.postingsCostSorted())
+            throw std::runtime_error("GraphBuilder: a per-term token cap needs cost-sorted posting lists");
+    }
+
+    // hitsAt(i, subStr, hits) fills hits with the yomi keys that are prefixes of
+    // subStr = str.substr(i) (PrefixHitUtf16, shortest first) and returns their
+    // count: one fused commonPrefixSearch per position, or a slice of the
+    // Aho-Corasick matches of the whole string.
+    template <class HitsAt>
+    static Graph constructGraphWith(
         const std::u16string &str,
-        const LOUDSReaderUtf16 &yomiCps,
-        const LOUDSWithTermIdReaderUtf16 &yomiTerm,
+        HitsAt &&hitsAt,
         const TokenArray &tokens,
         const PosTable &pos,
-        const LOUDSReaderUtf16 &tango)
+        const LOUDSReaderUtf16 &tango,
+        size_t maxTokensPerTerm)
     {
         const int n = static_cast<int>(str.size());
 
@@ -176,62 +266,29 @@ namespace kk
         graph[0].push_back(make_bos());
         graph[static_cast<size_t>(n) + 1].push_back(make_eos(n + 1));
 
+        // Reused by every position; the trie walk itself does not allocate.
+        std::vector<PrefixHitUtf16> yomiHits;
+
         for (int i = 0; i < n; ++i)
         {
-            const std::u16string subStr = str.substr(static_cast<size_t>(i));
+            const std::u16string_view subStr = std::u16string_view(str).substr(static_cast<size_t>(i));
             bool foundInAnyDictionary = false;
 
-            // System dictionary CPS
-            const auto yomiHits = yomiCps.commonPrefixSearch(subStr);
-            if (!yomiHits.empty())
+            // System dictionary CPS (prefix length and termId in one walk)
+            if (hitsAt(i, subStr, yomiHits) > 0)
                 foundInAnyDictionary = true;
 
-            for (const auto &yomiStr : yomiHits)
+            for (const auto &hit : yomiHits)
             {
-                const int32_t termId = yomiTerm.getTermId(yomiStr);
-                if (termId < 0)
+                if (hit.termId < 0)
                     continue;
-
-                const auto listToken = tokens.getTokensForTermId(termId);
-                const int endIndex = i + static_cast<int>(yomiStr.size());
-
-                for (const auto &t : listToken)
-                {
-                    std::u16string surface;
-                    if (t.nodeIndex == TokenArray::HIRAGANA_SENTINEL)
-                    {
-                        surface = yomiStr;
-                    }
-                    else if (t.nodeIndex == TokenArray::KATAKANA_SENTINEL)
-                    {
-                        surface = hira_to_kata(yomiStr);
-                    }
-                    else
-                    {
-                        surface = tango.getLetter(t.nodeIndex);
-                    }
-
-                    const auto [l, r] = pos.getLR(t.posIndex);
-                    const int cost = static_cast<int>(t.wordCost);
-
-                    Node node(
-                        /*l=*/l,
-                        /*r=*/r,
-                        /*score=*/cost,
-                        /*f=*/cost, // initial f=word cost (forwardDp will overwrite with best path cost)
-                        /*g=*/cost, // initial g is not used directly; backward search keeps g in state
-                        /*tango=*/std::move(surface),
-                        /*len=*/static_cast<int16_t>(yomiStr.size()),
-                        /*sPos=*/i);
-
-                    addOrUpdateNode(graph, endIndex, node);
-                }
+                addTokenNodes(graph, i, subStr.substr(0, hit.length), hit.length, hit.termId, 0, tokens, pos, tango, maxTokensPerTerm);
             }
 
             // Unknown fallback: 1-char
             if (!foundInAnyDictionary && !subStr.empty())
             {
-                const std::u16string yomi1 = subStr.substr(0, 1);
+                const std::u16string yomi1(subStr.substr(0, 1));
                 const int endIndex = i + 1;
 
                 Node unknownNode(
@@ -254,4 +311,118 @@ namespace kk
         return graph;
     }
 
+    // YomiTerm is any yomi backend with the fused
+    // commonPrefixSearch(u16string_view, std::vector<PrefixHitUtf16> &).
+    template <class YomiTerm>
+    static Graph constructGraphByPrefixSearch(
+        const std::u16string &str,
+        const YomiTerm &yomiTerm,
+        const TokenArray &tokens,
+        const PosTable &pos,
+        const LOUDSReaderUtf16 &tango,
+        size_t maxTokensPerTerm)
+    {
+        const auto hitsAt = [&yomiTerm](int, std::u16string_view subStr, std::vector<PrefixHitUtf16> &hits)
+        {
+            return yomiTerm.commonPrefixSearch(subStr, hits);
+        };
+        return constructGraphWith(str, hitsAt, tokens, pos, tango, maxTokensPerTerm);
+    }
+
+    Graph GraphBuilder::constructGraph(
+        const std::u16string &str,
+        const LOUDSWithTermIdReaderUtf16 &yomiTerm,
+        const TokenArray &tokens,
+        const PosTable &pos,
+        const LOUDSReaderUtf16 &tango,
+        size_t maxTokensPerTerm)
+    {
+        checkTokenCap(tokens, maxTokensPerTerm);
+
+        if (!yomiTerm.hasAhoCorasick() || str.size() < kAhoCorasickMinLength)
+            return constructGraphByPrefixSearch(str, yomiTerm, tokens, pos, tango, maxTokensPerTerm);
+
+        // One scan for the whole string, then hand each position its matches
+        // in the order commonPrefixSearch would (by start, shortest first).
+        std::vector<LOUDSWithTermIdReaderUtf16::Match> matches;
+        yomiTerm.findAllMatches(str, matches);
+        std::sort(matches.begin(), matches.end(),
+                  [](const auto &a, const auto &b)
+                  { return a.start != b.start ? a.start < b.start : a.length < b.length; });
+
+        size_t next = 0;
+        const auto hitsAt = [&](int i, std::u16string_view, std::vector<PrefixHitUtf16> &hits)
+        {
+            hits.clear();
+            for (; next < matches.size() && matches[next].start == static_cast<uint32_t>(i); ++next)
+                hits.push_back(PrefixHitUtf16{matches[next].length, matches[next].termId});
+            return hits.size();
+        };
+        return constructGraphWith(str, hitsAt, tokens, pos, tango, maxTokensPerTerm);
+    }
+
+    Graph GraphBuilder::constructGraph(
+        const std::u16string &str,
+        const LOUDSWithTermIdReaderUtf16 &yomiTerm,
+        const TokenArray &tokens,
+        const PosTable &pos,
+        const LOUDSReaderUtf16 &tango,
+        const FuzzyLattice &fuzzy,
+        size_t maxTokensPerTerm)
+    {
+        Graph graph = constructGraph(str, yomiTerm, tokens, pos, tango, maxTokensPerTerm);
+
+        std::vector<LOUDSWithTermIdReaderUtf16::FuzzyHit> hits;
+        const int n = static_cast<int>(str.size());
+        for (int i = 0; i < n; ++i)
+        {
+            yomiTerm.fuzzyCommonPrefixSearch(std::u16string_view(str).substr(static_cast<size_t>(i)), fuzzy.options, hits);
+            for (const auto &hit : hits)
+            {
+                // cost 0 is an exact hit, already in the graph
+                if (hit.cost == 0 || hit.termId < 0)
+                    continue;
+                const std::u16string key = yomiTerm.keyOf(hit.pos);
+                addTokenNodes(graph, i, key, hit.length, hit.termId, fuzzy.penaltyPerEdit * hit.cost, tokens, pos, tango, maxTokensPerTerm);
+            }
+        }
+        return graph;
+    }
+
+    Graph GraphBuilder::constructGraph(
+        const std::u16string &str,
+        const DoubleArrayReaderUtf16 &yomiTerm,
+        const TokenArray &tokens,
+        const PosTable &pos,
+        const LOUDSReaderUtf16 &tango,
+        size_t maxTokensPerTerm)
+    {
+        checkTokenCap(tokens, maxTokensPerTerm);
+        return constructGraphByPrefixSearch(str, yomiTerm, tokens, pos, tango, maxTokensPerTerm);
+    }
+
+    Graph GraphBuilder::constructGraph(
+        const std::u16string &str,
+        const PatriciaLOUDSReaderUtf16 &yomiTerm,
+        const TokenArray &tokens,
+        const PosTable &pos,
+        const LOUDSReaderUtf16 &tango,
+        size_t maxTokensPerTerm)
+    {
+        checkTokenCap(tokens, maxTokensPerTerm);
+        return constructGraphByPrefixSearch(str, yomiTerm, tokens, pos, tango, maxTokensPerTerm);
+    }
+
+    Graph GraphBuilder::constructGraph(
+        const std::u16string &str,
+        const DawgReaderUtf16 &yomiTerm,
+        const TokenArray &tokens,
+        const PosTable &pos,
+        const LOUDSReaderUtf16 &tango,
+        size_t maxTokensPerTerm)
+    {
+        checkTokenCap(tokens, maxTokensPerTerm);
+        return constructGraphByPrefixSearch(str, yomiTerm, tokens, pos, tango, maxTokensPerTerm);
+    }
+
 } // namespace kk
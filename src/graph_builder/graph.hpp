@@ -2,12 +2,18 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "common/mapped_file_utf16.hpp"
+#include "dawg/dawg_reader_utf16.hpp"
+#include "double_array/double_array_reader_utf16.hpp"
 #include "louds/louds_utf16_reader.hpp"
 #include "louds_with_term_id/louds_with_term_id_reader_utf16.hpp"
+#include "patricia/patricia_louds_reader_utf16.hpp"
 #include "token_array/token_array.hpp"
 
 namespace kk
@@ -17,6 +23,7 @@ namespace kk
     //   uint32_t n
     //   int16_t leftIds[n]
     //   int16_t rightIds[n]
+    // Both arrays are 2-byte aligned, which is all int16_t needs for mapFromFile.
     struct PosTable
     {
         std::vector<int16_t> leftIds;
@@ -24,8 +31,17 @@ namespace kk
 
         static PosTable loadFromFile(const std::string &path);
 
+        // Zero-copy: leftIds/rightIds stay empty and getLR reads the mapping.
+        static PosTable mapFromFile(const std::string &path);
+
         // Returns (l, r). If out of range, returns (0, 0).
         std::pair<int16_t, int16_t> getLR(uint16_t posIndex) const;
+
+    private:
+        // Set by mapFromFile only; the views point into map_.
+        std::shared_ptr<const MappedFile> map_;
+        std::span<const int16_t> leftView_;
+        std::span<const int16_t> rightView_;
     };
 
     struct Node
@@ -56,16 +72,80 @@ namespace kk
     // graph[endIndex] = list of nodes whose end position is endIndex
     using Graph = std::vector<std::vector<Node>>;
 
+    // Typo tolerance for GraphBuilder::constructGraph (yomi_termid.louds only).
+    // Besides the exact hits, every hit of fuzzyCommonPrefixSearch with an edit
+    // cost > 0 adds the key's tokens, their word cost raised by
+    // penaltyPerEdit * edit cost, so a typo path wins only when it beats the
+    // exact segmentation (and the 10000 unknown 1-char fallback).
+    struct FuzzyLattice
+    {
+        LOUDSWithTermIdReaderUtf16::FuzzyOptions options;
+        int penaltyPerEdit = 2000;
+    };
+
     class GraphBuilder
     {
     public:
+        // Shorter inputs keep the per-position search even with Aho-Corasick
+        // enabled. On the yomi lookups alone (root table on), the scan was
+        // 1.1-3.7x slower than the per-position search for lengths 1-4 on both
+        // test dictionaries; from 5 on it ranged from 0.85x to 1.8x depending on
+        // the key lengths, so enableAhoCorasick stays opt-in.
+        static constexpr size_t kAhoCorasickMinLength = 5;
+
+        // Lattice over str. Each position runs one fused common-prefix search on
+        // yomiTerm, which yields the matched lengths together with their termIds.
+        // When yomiTerm.enableAhoCorasick() was called and str has at least
+        // kAhoCorasickMinLength code units, one findAllMatches scan over str
+        // replaces the per-position searches (same lattice).
+        // Surfaces come from tango.getLetter, or from tokens.surfacePool() when
+        // one is attached (all overloads). Each hit adds at most maxTokensPerTerm
+        // of its cheapest tokens (all overloads); a cap other than SIZE_MAX
+        // throws unless tokens.postingsCostSorted(), and 0 always throws.
+        static Graph constructGraph(
+            const std::u16string &str,
+            const LOUDSWithTermIdReaderUtf16 &yomiTerm,
+            const TokenArray &tokens,
+            const PosTable &pos,
+            const LOUDSReaderUtf16 &tango,
+            size_t maxTokensPerTerm = SIZE_MAX);
+
+        // Same lattice plus the penalized fuzzy hits (see FuzzyLattice).
         static Graph constructGraph(
             const std::u16string &str,
-            const LOUDSReaderUtf16 &yomiCps,
             const LOUDSWithTermIdReaderUtf16 &yomiTerm,
             const TokenArray &tokens,
             const PosTable &pos,
-            const LOUDSReaderUtf16 &tango);
+            const LOUDSReaderUtf16 &tango,
+            const FuzzyLattice &fuzzy,
+            size_t maxTokensPerTerm = SIZE_MAX);
+
+        // Same lattice with the double-array yomi backend (yomi_termid.da).
+        static Graph constructGraph(
+            const std::u16string &str,
+            const DoubleArrayReaderUtf16 &yomiTerm,
+            const TokenArray &tokens,
+            const PosTable &pos,
+            const LOUDSReaderUtf16 &tango,
+            size_t maxTokensPerTerm = SIZE_MAX);
+
+        // Same lattice with the path-compressed yomi backend (yomi_termid.plouds).
+        static Graph constructGraph(
+            const std::u16string &str,
+            const PatriciaLOUDSReaderUtf16 &yomiTerm,
+            const TokenArray &tokens,
+            const PosTable &pos,
+            const LOUDSReaderUtf16 &tango,
+            size_t maxTokensPerTerm = SIZE_MAX);
+
+        // Same lattice with the minimized-automaton yomi backend (yomi_termid.dawg).
+        static Graph constructGraph(
+            const std::u16string &str,
+            const DawgReaderUtf16 &yomiTerm,
+            const TokenArray &tokens,
+            const PosTable &pos,
+            const LOUDSReaderUtf16 &tango,
+            size_t maxTokensPerTerm = SIZE_MAX);
     };
 
 } // namespace kk
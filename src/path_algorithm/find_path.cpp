@@ -1,8 +1,13 @@
 // src/path_algorithm/find_path.cpp
 #include "path_algorithm/find_path.hpp"
 
+#include "connection_id/connection_id_builder.hpp"
+
 #include <algorithm>
+#include <bit>
 #include <cmath>
+#include <cstring>
+#include <fstream>
 #include <limits>
 #include <queue>
 #include <stdexcept>
@@ -15,15 +20,117 @@ namespace kk
     // ConnectionMatrix
     // -----------------------------
     ConnectionMatrix::ConnectionMatrix(std::vector<int16_t> v)
-        : dim_(0), data_(std::move(v))
+        : dim_(0), data_(std::move(v)), view_(data_)
+    {
+        setDim();
+    }
+
+    ConnectionMatrix ConnectionMatrix::mapFromFile(const std::string &path)
+    {
+        auto map = MappedFile::open(path);
+        const uint8_t *p = map->data();
+        const size_t n = map->size();
+        return fromBytes(p, n, std::move(map), path);
+    }
+
+    ConnectionMatrix ConnectionMatrix::loadFromFile(const std::string &path)
+    {
+        std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+        if (!ifs)
+            throw std::runtime_error("ConnectionMatrix: failed to open: " + path);
+        const size_t n = static_cast<size_t>(ifs.tellg());
+        std::vector<uint64_t> buf((n + 7) / 8); // 8-byte aligned like a mapping
+        ifs.seekg(0);
+        if (n > 0)
+            ifs.read(reinterpret_cast<char *>(buf.data()), static_cast<std::streamsize>(n));
+        if (!ifs)
+            throw std::runtime_error("ConnectionMatrix: failed to read: " + path);
+        return fromBytes(reinterpret_cast<const uint8_t *>(buf.data()), n, nullptr, path);
+    }
+
+    ConnectionMatrix ConnectionMatrix::fromBytes(const uint8_t *p, size_t n,
+                                                 std::shared_ptr<const MappedFile> map,
+                                                 const std::string &path)
+    {
+        using CB = ConnectionIdBuilder;
+
+        ConnectionMatrix m;
+        uint32_t header[4] = {};
+        if (n >= CB::kMatrixHeaderSize)
+            std::memcpy(header, p, sizeof(header));
+
+        if (n >= CB::kMatrixHeaderSize &&
+            (header[0] == CB::kMatrixMagic || header[0] == CB::byteSwap32(CB::kMatrixMagic)))
+        {
+            // a file written on a host of the other byte order has every field swapped
+            const bool swap = header[0] != CB::kMatrixMagic;
+            if (swap)
+            {
+                for (auto &h : header)
+                    h = CB::byteSwap32(h);
+            }
+            if (header[1] != CB::kMatrixVersion)
+                throw std::runtime_error("ConnectionMatrix: unsupported version " + std::to_string(header[1]) + ": " + path);
+            if (header[2] != CB::kByteOrderMark)
+                throw std::runtime_error("ConnectionMatrix: bad byte order mark: " + path);
+
+            const uint64_t dim = header[3];
+            const size_t count = static_cast<size_t>(dim * dim);
+            if (count > (n - CB::kMatrixHeaderSize) / sizeof(int16_t))
+                throw std::runtime_error("ConnectionMatrix: truncated: " + path);
+
+            const uint8_t *data = p + CB::kMatrixHeaderSize;
+            if (!swap && map)
+            {
+                m.view_ = std::span<const int16_t>(reinterpret_cast<const int16_t *>(data), count);
+                m.map_ = std::move(map);
+            }
+            else
+            {
+                m.data_.resize(count);
+                std::memcpy(m.data_.data(), data, count * sizeof(int16_t));
+                if (swap)
+                {
+                    for (auto &x : m.data_)
+                        x = static_cast<int16_t>(CB::byteSwap16(static_cast<uint16_t>(x)));
+                }
+                m.view_ = m.data_;
+            }
+        }
+        else
+        {
+            // legacy: headerless big-endian int16 array
+            if (n % sizeof(int16_t) != 0)
+                throw std::runtime_error("ConnectionMatrix: binary length is odd: " + path);
+            const size_t count = n / sizeof(int16_t);
+            if constexpr (std::endian::native == std::endian::big)
+            {
+                if (map)
+                {
+                    m.view_ = std::span<const int16_t>(reinterpret_cast<const int16_t *>(p), count);
+                    m.map_ = std::move(map);
+                    m.setDim();
+                    return m;
+                }
+            }
+            m.data_.resize(count);
+            for (size_t i = 0; i < count; ++i)
+                m.data_[i] = static_cast<int16_t>((static_cast<uint16_t>(p[2 * i]) << 8) | p[2 * i + 1]);
+            m.view_ = m.data_;
+        }
+        m.setDim();
+        return m;
+    }
+
+    void ConnectionMatrix::setDim()
     {
-        if (data_.empty())
+        if (view_.empty())
             throw std::runtime_error("ConnectionMatrix: empty data");
 
-        const double root = std::sqrt(static_cast<double>(data_.size()));
+        const double root = std::sqrt(static_cast<double>(view_.size()));
         const int n = static_cast<int>(root + 0.5);
-        if (n <= 0 || static_cast<size_t>(n) * static_cast<size_t>(n) != data_.size())
-            throw std::runtime_error("ConnectionMatrix: size is not a perfect square: " + std::to_string(data_.size()));
+        if (n <= 0 || static_cast<size_t>(n) * static_cast<size_t>(n) != view_.size())
+            throw std::runtime_error("ConnectionMatrix: size is not a perfect square: " + std::to_string(view_.size()));
 
         dim_ = n;
     }
@@ -34,7 +141,7 @@ namespace kk
             return 0;
         if (leftId >= dim_ || rightId >= dim_)
             return 0;
-        return static_cast<int>(data_[static_cast<size_t>(leftId) * static_cast<size_t>(dim_) + static_cast<size_t>(rightId)]);
+        return static_cast<int>(view_[static_cast<size_t>(leftId) * static_cast<size_t>(dim_) + static_cast<size_t>(rightId)]);
     }
 
     // -----------------------------
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
@@ -29,14 +30,37 @@ namespace kk
         ConnectionMatrix() : dim_(0) {}
         explicit ConnectionMatrix(std::vector<int16_t> v);
 
+        // view_ points into data_ or map_, so copying is not allowed.
+        ConnectionMatrix(const ConnectionMatrix &) = delete;
+        ConnectionMatrix &operator=(const ConnectionMatrix &) = delete;
+        ConnectionMatrix(ConnectionMatrix &&) = default;
+        ConnectionMatrix &operator=(ConnectionMatrix &&) = default;
+
+        // Accepts both connection_matrix.bin (v2 header, native endian; see
+        // ConnectionIdBuilder::writeMatrixV2) and the legacy headerless
+        // big-endian connection_single_column.bin.
+        //
+        // mapFromFile: a v2 file in host byte order is used in place from the
+        // mapping; anything else is decoded into memory in one pass.
+        static ConnectionMatrix mapFromFile(const std::string &path);
+        static ConnectionMatrix loadFromFile(const std::string &path);
+
         int dim() const { return dim_; }
-        size_t size() const { return data_.size(); }
+        size_t size() const { return view_.size(); }
 
         int get(int leftId, int rightId) const;
 
     private:
         int dim_;
         std::vector<int16_t> data_;
+        std::shared_ptr<const MappedFile> map_;
+        std::span<const int16_t> view_;
+
+        // map is kept (and viewed in place) only when the bytes can be used as is.
+        static ConnectionMatrix fromBytes(const uint8_t *p, size_t n,
+                                          std::shared_ptr<const MappedFile> map,
+                                          const std::string &path);
+        void setDim();
     };
 
     class FindPath